@@ -0,0 +1,104 @@
+#include <thread>
+#include "Asset_Loader.h"
+#include "Job_System.h"
+#include "Colour.h"
+
+Asset_Loader::Asset_Loader(Job_System* jobs)
+{
+	this->jobs = jobs;
+	finished.store(nullptr);
+	pending.store(0);
+
+	//Magenta and black checkerboard, obvious on screen if something never finishes loading
+	placeholder.textureWidth = 8;
+	placeholder.textureHeight = 8;
+	placeholder.data = new Colour[64];
+	for (int h = 0; h < 8; h++)
+		for (int w = 0; w < 8; w++)
+			placeholder.data[h * 8 + w] = ((w / 2 + h / 2) & 1) ? PINK : BLACK;
+}
+
+Asset_Loader::~Asset_Loader()
+{
+	//Loads still decoding hold raw pointers to their asset, let them land before anything is freed.
+	//Only Publish retires a load, so drain the finished list every time round
+	while (true)
+	{
+		Publish();
+		if (!pending.load())
+			break;
+		if (!jobs->RunPending())
+			std::this_thread::yield();
+	}
+}
+
+Asset_Loader::Texture_Handle Asset_Loader::LoadTexture(const std::string& filePath, const std::function<void(Texture_Asset&)>& onLoaded)
+{
+	Texture_Handle asset = std::make_shared<Texture_Asset>();
+	asset->filePath = filePath;
+	asset->texture = &placeholder;
+	asset->decoded = nullptr;
+	asset->loaded = false;
+	asset->failed = false;
+	asset->onLoaded = onLoaded;
+	asset->nextFinished = nullptr;
+
+	pending++;
+	inFlight.push_back(asset);
+
+	Texture_Asset* target = asset.get();
+	jobs->SubmitBackground(jobs->Create([this, target]()
+		{
+			Texture* texture = new Texture();
+			if (!texture->LoadTexture(target->filePath))
+			{
+				delete texture;
+				texture = nullptr;
+			}
+			target->decoded = texture;
+
+			//Lock-free push onto the finished list, the game thread takes the whole list at once
+			target->nextFinished = finished.load(std::memory_order_relaxed);
+			while (!finished.compare_exchange_weak(target->nextFinished, target, std::memory_order_release, std::memory_order_relaxed)) { }
+		}));
+
+	return asset;
+}
+
+void Asset_Loader::Publish()
+{
+	//Without workers nothing else runs the decode jobs, so take one per frame here
+	if (!jobs->WorkerCount())
+		jobs->RunPending();
+
+	Texture_Asset* asset = finished.exchange(nullptr, std::memory_order_acquire);
+	while (asset)
+	{
+		Texture_Asset* next = asset->nextFinished;
+
+		if (asset->decoded)
+		{
+			asset->texture = asset->decoded;
+			asset->loaded = true;
+		}
+		else
+			asset->failed = true;
+		pending--;
+
+		if (asset->onLoaded)
+			asset->onLoaded(*asset);
+
+		//Drop the loader's reference, the game keeps the asset alive through its own handle
+		for (size_t i = 0; i < inFlight.size(); i++)
+		{
+			if (inFlight[i].get() == asset)
+			{
+				inFlight[i] = inFlight.back();
+				inFlight.pop_back();
+				break;
+			}
+		}
+
+		asset = next;
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Texture.h"
+
+class Job_System;
+
+class Asset_Loader
+{
+public:
+	//texture points at the placeholder until the load is published, then at the decoded texture
+	struct Texture_Asset
+	{
+		std::string filePath;
+		Texture* texture;
+		Texture* decoded;
+		bool loaded;
+		bool failed;
+		std::function<void(Texture_Asset&)> onLoaded;
+		Texture_Asset* nextFinished;
+
+		~Texture_Asset() { delete decoded; }
+	};
+	typedef std::shared_ptr<Texture_Asset> Texture_Handle;
+
+	Job_System* jobs;
+	Texture placeholder;
+
+	Asset_Loader(Job_System* jobs);
+	~Asset_Loader();
+
+	Texture_Handle LoadTexture(const std::string& filePath, const std::function<void(Texture_Asset&)>& onLoaded = nullptr);
+
+	//Swaps finished assets in and runs their callbacks, call from the game thread between frames
+	void Publish();
+
+	int Pending() const { return pending.load(); }
+
+private:
+	std::atomic<Texture_Asset*> finished;
+	std::atomic<int> pending;
+	std::vector<Texture_Handle> inFlight;
+};
@@ -0,0 +1,525 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include "Benchmark.h"
+#include "CGE.h"
+
+Benchmark::Benchmark(CGE* engine)
+{
+	this->engine = engine;
+}
+
+void Benchmark::HierarchicalDepth(int layers, int frames)
+{
+	//Full screen quads drawn front to back, so every layer after the first is completely hidden
+	Vector2 size = engine->screenSize;
+	bool previous = engine->hierarchicalDepth;
+
+	printf("Hierarchical depth: %d layers, %d frames, %dx%d\n", layers, frames, engine->screenSize.i, engine->screenSize.j);
+
+	for (int pass = 0; pass < 2; pass++)
+	{
+		engine->hierarchicalDepth = pass == 0;
+		engine->depthStats = { };
+		Timer timer;
+
+		for (int frame = 0; frame < frames; frame++)
+		{
+			engine->screenBuffer.ResetBuffer3D(engine->screenSize);
+			for (int layer = 0; layer < layers; layer++)
+			{
+				float depth = (layer + 1.0f) / (layers + 1.0f);
+				Colour colour(layer * 37 % 256, layer * 91 % 256, layer * 53 % 256);
+				engine->DrawTriangle({ 0, 0, depth }, { size.i, 0, depth }, { size.i, size.j, depth }, colour);
+				engine->DrawTriangle({ 0, 0, depth }, { size.i, size.j, depth }, { 0, size.j, depth }, colour);
+			}
+		}
+
+		double elapsed = timer.elapsed() * 1000;
+		printf("  %-4s fragments tested: %12lld  tiles skipped: %8lld / %8lld  %8.2f ms/frame\n",
+			engine->hierarchicalDepth ? "on" : "off",
+			engine->depthStats.fragmentsTested / frames,
+			engine->depthStats.tilesSkipped / frames,
+			engine->depthStats.tilesTested / frames,
+			elapsed / frames);
+	}
+
+	engine->hierarchicalDepth = previous;
+	engine->depthStats = { };
+}
+
+void Benchmark::PresentThread(int frames)
+{
+	printf("Present thread: %d frames, %dx%d\n", frames, engine->screenSize.i, engine->screenSize.j);
+	if (engine->headless)
+	{
+		printf("  skipped, nothing is presented headless\n");
+		return;
+	}
+
+	for (int pass = 0; pass < 2; pass++)
+	{
+		engine->SetPresentThread(pass == 1);
+
+		//Synchronous presents are timed directly, the present thread measures submit to write completion
+		double presentTime = 0;
+		Timer timer;
+		for (int frame = 0; frame < frames; frame++)
+		{
+			engine->ResetBuffer();
+			for (int i = 0; i < 8; i++)
+				engine->DrawCircle({ (float)(frame * 3 + i * 25 % engine->screenSize.i), engine->screenSize.j * 0.5f }, 20.0f, { 255, i * 30, 0, 128 });
+
+			double before = timer.elapsed();
+			engine->DrawBuffer();
+			presentTime += timer.elapsed() - before;
+		}
+		double elapsed = timer.elapsed();
+
+		if (engine->presentThread)
+		{
+			Present_Thread& present = *engine->presentThread;
+			long long presented = present.framesPresented.load();
+			printf("  threaded: %8.1f fps  latency %6.2f ms  presented %lld  dropped %lld\n",
+				frames / elapsed,
+				presented ? present.totalLatency.load() * 0.000001 / presented : 0.0,
+				presented, present.framesDropped.load());
+		}
+		else
+		{
+			printf("  direct:   %8.1f fps  latency %6.2f ms\n", frames / elapsed, presentTime * 1000 / frames);
+		}
+	}
+
+	engine->SetPresentThread(false);
+}
+
+void Benchmark::JobScaling(int repetitions)
+{
+	//Nearest console colour search for every pixel, a stand-in for a resolve pass
+	int screenArea = engine->screenSize.i * engine->screenSize.j;
+	int* results = new int[screenArea];
+	for (int i = 0; i < screenArea; i++)
+		engine->screenBuffer.pixelBuffer[i] = Colour(i * 7 % 256, i * 13 % 256, i * 29 % 256);
+
+	int hardware = (int)std::thread::hardware_concurrency();
+	printf("Job scaling: %d pixels, %d repetitions, 1-%d threads\n", screenArea, repetitions, hardware);
+
+	double baseline = 0;
+	for (int threads = 1; threads <= hardware; threads++)
+	{
+		Job_System jobs(threads - 1);
+		Timer timer;
+		for (int repetition = 0; repetition < repetitions; repetition++)
+		{
+			jobs.ParallelFor(0, screenArea, 1024, [&](int first, int last)
+				{
+					for (int i = first; i < last; i++)
+						results[i] = engine->colourMap.GetConsoleColour(engine->screenBuffer.pixelBuffer[i]);
+				});
+		}
+
+		double elapsed = timer.elapsed() * 1000 / repetitions;
+		if (threads == 1)
+			baseline = elapsed;
+		printf("  %2d threads: %8.3f ms  %5.2fx\n", threads, elapsed, baseline / elapsed);
+	}
+
+	delete[] results;
+}
+
+void Benchmark::Primitives(int warmup, int repetitions)
+{
+	tVector2<int> size = engine->screenSize;
+	printf("Primitives: %dx%d, %d warmup, %d repetitions\n", size.i, size.j, warmup, repetitions);
+
+	//Same pseudo random layout every run so results stay comparable between builds
+	const int pointCount = 4096;
+	Vector2* points = new Vector2[pointCount];
+	unsigned int seed = 12345;
+	for (int i = 0; i < pointCount; i++)
+	{
+		seed = seed * 1664525 + 1013904223;
+		points[i].i = (float)((seed >> 8) % size.i);
+		seed = seed * 1664525 + 1013904223;
+		points[i].j = (float)((seed >> 8) % size.j);
+	}
+	auto point = [points](int index) { return points[index % pointCount]; };
+	float radius = size.j * 0.125f;
+	Vector2 extent = { size.i * 0.25f, size.j * 0.25f };
+
+	int opacities[] = { 255, 128 };
+	for (int opacity : opacities)
+	{
+		Colour colour(255, 160, 40, opacity);
+
+		Time("SetPixel", opacity, 4096, warmup, repetitions, [&](int i)
+			{
+				Vector2 p = point(i);
+				engine->SetPixel(tVector2<int>{ (int)p.i, (int)p.j }, colour);
+			});
+		Time("DrawLine", opacity, 256, warmup, repetitions, [&](int i)
+			{
+				Vector2 a = point(i * 2), b = point(i * 2 + 1);
+				engine->DrawLine(tVector2<int>{ (int)a.i, (int)a.j }, tVector2<int>{ (int)b.i, (int)b.j }, colour);
+			});
+		Time("DrawPolyline", opacity, 16, warmup, repetitions, [&](int i) { engine->DrawPolyline(points + i * 16 % (pointCount - 16), 16, colour); });
+		Time("DrawPolylineEx", opacity, 16, warmup, repetitions, [&](int i) { engine->DrawPolylineEx(points + i * 16 % (pointCount - 16), 16, 3, colour, Join_Round); });
+		Time("DrawLineEx", opacity, 64, warmup, repetitions, [&](int i) { engine->DrawLineEx(point(i * 2), point(i * 2 + 1), colour, 3); });
+		Time("DrawCircle", opacity, 32, warmup, repetitions, [&](int i) { engine->DrawCircle(point(i), radius, colour); });
+		Time("DrawCircleLine", opacity, 32, warmup, repetitions, [&](int i) { engine->DrawCircleLine(point(i), radius, colour, 2); });
+		Time("DrawOvalLine", opacity, 32, warmup, repetitions, [&](int i) { engine->DrawOvalLine(point(i), extent, i * 0.1f, colour, 2); });
+		Time("DrawRect", opacity, 32, warmup, repetitions, [&](int i) { engine->DrawRect(point(i), extent, 0, colour); });
+		Time("DrawRectRotated", opacity, 32, warmup, repetitions, [&](int i) { engine->DrawRect(point(i), extent, 0.3f + i * 0.1f, colour); });
+		Time("DrawPoly", opacity, 32, warmup, repetitions, [&](int i)
+			{
+				Poly<6> hexagon(point(i), i * 0.1f);
+				for (Vector2& corner : hexagon.point)
+					corner = { corner.i * radius, corner.j * radius };
+				engine->DrawPoly(hexagon, 0, colour);
+			});
+		Time("DrawTriangle", opacity, 64, warmup, repetitions, [&](int i) { engine->DrawTriangle(point(i * 3), point(i * 3 + 1), point(i * 3 + 2), colour); });
+	}
+
+	//Neither depends on what was drawn, opacity is reported as opaque
+	Time("Clear", 255, 1, warmup, repetitions, [&](int) { engine->ResetBuffer(); });
+	Time("Present", 255, 1, warmup, repetitions, [&](int) { engine->DrawBuffer(); });
+
+	delete[] points;
+}
+
+void Benchmark::AntiAliasing(int warmup, int repetitions)
+{
+	tVector2<int> size = engine->screenSize;
+	printf("Anti-aliasing: %dx%d, %d warmup, %d repetitions\n", size.i, size.j, warmup, repetitions);
+
+	const int lineCount = 256;
+	const int circleCount = 64;
+	Vector2 ends[lineCount * 2];
+	for (int i = 0; i < lineCount * 2; i++)
+		ends[i] = { (float)(i * 37 % size.i) + 0.3f, (float)(i * 53 % size.j) + 0.6f };
+	float radius = size.j * 0.125f;
+	Colour colour(255, 160, 40);
+
+	//The AA versions write a different number of pixels than the aliased ones, so costs are compared per pixel touched
+	int area = size.i * size.j;
+	Colour* cleared = new Colour[area];
+	auto pixelsPerCall = [&](int count, const std::function<void(int)>& draw)
+	{
+		long long touched = 0;
+		for (int i = 0; i < count; i++)
+		{
+			engine->ResetBuffer();
+			memcpy(cleared, engine->screenBuffer.pixelBuffer, sizeof(Colour) * area);
+			draw(i);
+			for (int p = 0; p < area; p++)
+				touched += memcmp(&cleared[p], &engine->screenBuffer.pixelBuffer[p], sizeof(Colour)) != 0;
+		}
+		return (double)touched / count;
+	};
+
+	std::function<void(int)> draws[4] =
+	{
+		[&](int i) { engine->DrawLine(tVector2<int>{ (int)ends[i * 2].i, (int)ends[i * 2].j }, tVector2<int>{ (int)ends[i * 2 + 1].i, (int)ends[i * 2 + 1].j }, colour); },
+		[&](int i) { engine->DrawLineAA(ends[i * 2], ends[i * 2 + 1], colour); },
+		[&](int i) { engine->DrawCircleLine(ends[i], radius, colour, 1); },
+		[&](int i) { engine->DrawCircleAA(ends[i], radius, colour); }
+	};
+	const char* names[4] = { "DrawLine", "DrawLineAA", "DrawCircleLine", "DrawCircleAA" };
+	int counts[4] = { lineCount, lineCount, circleCount, circleCount };
+
+	size_t start = results.size();
+	double perPixel[4];
+	for (int k = 0; k < 4; k++)
+	{
+		Time(names[k], 255, counts[k], warmup, repetitions, draws[k]);
+		double pixels = pixelsPerCall(counts[k], draws[k]);
+		perPixel[k] = pixels > 0 ? results.back().median * 1000 / pixels : 0;
+		printf("  %-16s %8.1f pixels per call %8.3f ns per pixel\n", names[k], pixels, perPixel[k]);
+	}
+	delete[] cleared;
+
+	printf("  line   AA/aliased per pixel %5.2fx\n", perPixel[0] > 0 ? perPixel[1] / perPixel[0] : 0);
+	printf("  circle AA/aliased per pixel %5.2fx\n", perPixel[2] > 0 ? perPixel[3] / perPixel[2] : 0);
+
+	//The aliased baselines share their names with cases Primitives records, keep only the new ones
+	results.erase(results.begin() + start + 2);
+	results.erase(results.begin() + start);
+}
+
+void Benchmark::Layers(int warmup, int repetitions)
+{
+	tVector2<int> size = engine->screenSize;
+	printf("Layers: %dx%d, %d warmup, %d repetitions\n", size.i, size.j, warmup, repetitions);
+
+	auto scene = [&]()
+	{
+		engine->SetBuffer(DARK_BLUE);
+		for (int i = 0; i < 32; i++)
+		{
+			Vector2 centre = { (float)(i * 37 % size.i), (float)(i * 53 % size.j) };
+			engine->DrawCircle(centre, size.j * 0.1f, GREEN);
+			engine->DrawTriangle(centre, centre + Vector2{ size.i * 0.2f, 0 }, centre + Vector2{ 0, size.j * 0.2f }, BROWN);
+		}
+	};
+
+	Render_Target background(size);
+	Render_Target overlay(size);
+	engine->UpdateLayer(background, scene);
+	engine->UpdateLayer(overlay, [&]() { engine->DrawRect(Vector2{ size.i * 0.5f, size.j * 0.5f }, Vector2{ size.i * 0.5f, size.j * 0.5f }, 0, WHITE); });
+
+	size_t start = results.size();
+	Time("LayerRedraw", 255, 1, warmup, repetitions, [&](int) { scene(); });
+	Time("LayerCopy", 255, 1, warmup, repetitions, [&](int) { engine->Composite(background, 0, 0); });
+	Time("LayerBlend", 128, 1, warmup, repetitions, [&](int) { engine->Composite(overlay, 0, 0, Composite_Alpha, 128); });
+
+	printf("  redraw/composite %5.2fx\n", results[start].median / results[start + 1].median);
+}
+
+void Benchmark::PartialRedraw(int warmup, int repetitions)
+{
+	tVector2<int> size = engine->screenSize;
+	printf("PartialRedraw: %dx%d, %d warmup, %d repetitions\n", size.i, size.j, warmup, repetitions);
+
+	auto scene = [&]()
+	{
+		engine->SetBuffer(DARK_BLUE);
+		for (int i = 0; i < 32; i++)
+		{
+			Vector2 centre = { (float)(i * 37 % size.i), (float)(i * 53 % size.j) };
+			engine->DrawCircle(centre, size.j * 0.1f, GREEN);
+			engine->DrawTriangle(centre, centre + Vector2{ size.i * 0.2f, 0 }, centre + Vector2{ 0, size.j * 0.2f }, BROWN);
+		}
+	};
+
+	size_t start = results.size();
+	Time("FullRedraw", 255, 1, warmup, repetitions, [&](int) { scene(); });
+
+	//Two squares a tenth of the screen across, about 2% of its area
+	int side = size.j / 10 > 1 ? size.j / 10 : 1;
+	engine->SetRetainedMode(true);
+	engine->ResetBuffer();
+	engine->Redraw(scene);
+	Time("PartialRedraw", 255, 1, warmup, repetitions, [&](int)
+		{
+			engine->Invalidate(size.i / 4, size.j / 4, side, side);
+			engine->Invalidate(size.i * 3 / 4 - side, size.j * 3 / 4 - side, side, side);
+			engine->ResetBuffer();
+			engine->Redraw(scene);
+		});
+	engine->SetRetainedMode(false);
+
+	printf("  full/partial %5.2fx\n", results[start].median / results[start + 1].median);
+}
+
+void Benchmark::OutputModes(int warmup, int repetitions)
+{
+	tVector2<int> console = engine->consoleSize;
+	printf("OutputModes: %dx%d cells, %d warmup, %d repetitions\n", console.i, console.j, warmup, repetitions);
+
+	const char* names[4] = { "OutputShade", "OutputHalfBlock", "OutputQuadrant", "OutputBraille" };
+	for (int mode = Output_Shade; mode <= Output_Braille; mode++)
+	{
+		engine->SetOutputMode((Output_Mode)mode);
+		tVector2<int> size = engine->screenSize;
+		Time(names[mode], 255, 1, warmup, repetitions, [&](int)
+			{
+				for (int i = 0; i < 32; i++)
+				{
+					Vector2 centre = { (float)(i * 37 % size.i), (float)(i * 53 % size.j) };
+					engine->DrawCircleLine(centre, size.j * 0.1f, GREEN);
+					engine->DrawLine(tVector2<int>{ 0, 0 }, tVector2<int>{ (int)centre.i, (int)centre.j }, WHITE);
+				}
+				if (engine->cellBuffer)
+					engine->Resolve();
+			});
+	}
+	engine->SetOutputMode(Output_Shade);
+}
+
+void Benchmark::TerminalEncoding(int frames)
+{
+	tVector2<int> size = engine->screenSize;
+	printf("TerminalEncoding: %dx%d, %d frames\n", engine->consoleSize.i, engine->consoleSize.j, frames);
+	engine->quantizer.Initialise(engine->colourMap);
+
+	const char* names[3] = { "", "EncodeTruecolor", "EncodeXterm256" };
+	for (int mode = Present_Truecolor; mode <= Present_Xterm256; mode++)
+	{
+		Terminal_Presenter presenter(nullptr, engine->consoleSize, (Present_Mode)mode, engine->quantizer);
+		std::vector<double> times(frames);
+		double bytes = 0;
+		size_t firstFrame = 0;
+
+		//Frame -1 writes every cell and is reported on its own, the rest only write what moved
+		for (int frame = -1; frame < frames; frame++)
+		{
+			engine->ResetBuffer();
+			engine->SetBuffer(DARK_BLUE);
+			engine->DrawRect(Vector2{ size.i * 0.5f, size.j * 0.1f }, Vector2{ (float)size.i, size.j * 0.2f }, 0, DARK_GREEN);
+			for (int i = 0; i < 8; i++)
+				engine->DrawCircle({ (float)((frame + 1) * 2 + i * 25 % size.i), size.j * (0.3f + i * 0.05f) }, size.j * 0.08f, { 255, i * 30, 0 });
+
+			presenter.Resolve(engine->screenBuffer.pixelBuffer, size, engine->outputMode);
+			Timer timer;
+			presenter.Encode();
+			double elapsed = timer.elapsed() * 1000000;
+
+			if (frame < 0)
+				firstFrame = presenter.frame.size();
+			else
+			{
+				times[frame] = elapsed;
+				bytes += presenter.frame.size();
+			}
+		}
+
+		std::sort(times.begin(), times.end());
+		double total = 0;
+		for (double time : times)
+			total += time;
+
+		Result result;
+		result.name = names[mode];
+		result.width = engine->consoleSize.i;
+		result.height = engine->consoleSize.j;
+		result.opacity = 255;
+		result.median = times[frames / 2];
+		result.minimum = times[0];
+		result.mean = total / frames;
+		result.repetitions = frames;
+		result.bytes = bytes / frames;
+		results.push_back(result);
+
+		printf("  %-16s median %10.3f us  %8.0f B/frame  first frame %zu B\n", result.name.c_str(), result.median, result.bytes, firstFrame);
+	}
+}
+
+void Benchmark::Time(const char* name, int opacity, int count, int warmup, int repetitions, const std::function<void(int)>& draw)
+{
+	std::vector<double> times(repetitions);
+	for (int repetition = -warmup; repetition < repetitions; repetition++)
+	{
+		//Start each repetition from a cleared frame so blending never sees saturated pixels
+		engine->ResetBuffer();
+
+		Timer timer;
+		for (int i = 0; i < count; i++)
+			draw(i);
+		double elapsed = timer.elapsed() * 1000000 / count;
+
+		if (repetition >= 0)
+			times[repetition] = elapsed;
+	}
+
+	std::sort(times.begin(), times.end());
+	double total = 0;
+	for (double time : times)
+		total += time;
+
+	Result result;
+	result.name = name;
+	result.width = engine->screenSize.i;
+	result.height = engine->screenSize.j;
+	result.opacity = opacity;
+	result.median = times[repetitions / 2];
+	result.minimum = times[0];
+	result.mean = total / repetitions;
+	result.repetitions = repetitions;
+	results.push_back(result);
+
+	printf("  %-16s %3d  median %10.3f us  min %10.3f us  mean %10.3f us\n", name, opacity, result.median, result.minimum, result.mean);
+}
+
+bool Benchmark::WriteResults(const std::string& filePath) const
+{
+	std::fstream file;
+	file.open(filePath, std::ios::out | std::ios::trunc);
+	if (!file.is_open())
+		return false;
+
+	//One result per line keeps ReadResults trivial and diffs readable
+	char line[512];
+	file << "[\n";
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const Result& result = results[i];
+		sprintf_s(line, "{\"name\": \"%s\", \"width\": %d, \"height\": %d, \"opacity\": %d, \"median\": %.4f, \"min\": %.4f, \"mean\": %.4f, \"repetitions\": %d, \"bytes\": %.1f}%s\n",
+			result.name.c_str(), result.width, result.height, result.opacity,
+			result.median, result.minimum, result.mean, result.repetitions, result.bytes,
+			i + 1 < results.size() ? "," : "");
+		file << line;
+	}
+	file << "]\n";
+
+	return true;
+}
+
+bool Benchmark::ReadResults(const std::string& filePath, std::vector<Result>& results)
+{
+	std::fstream file;
+	file.open(filePath, std::ios::in);
+	if (!file.is_open())
+		return false;
+
+	std::string line;
+	char name[128];
+	while (std::getline(file, line))
+	{
+		Result result;
+		if (sscanf_s(line.c_str(), " {\"name\": \"%127[^\"]\", \"width\": %d, \"height\": %d, \"opacity\": %d, \"median\": %lf, \"min\": %lf, \"mean\": %lf, \"repetitions\": %d",
+			name, (unsigned)sizeof(name), &result.width, &result.height, &result.opacity,
+			&result.median, &result.minimum, &result.mean, &result.repetitions) != 8)
+			continue;
+
+		//Older files have no bytes
+		const char* bytes = strstr(line.c_str(), "\"bytes\": ");
+		result.bytes = bytes ? atof(bytes + 9) : 0;
+		result.name = name;
+		results.push_back(result);
+	}
+
+	return true;
+}
+
+int Benchmark::Compare(const std::string& baselinePath, const std::string& currentPath, float threshold)
+{
+	std::vector<Result> baseline, current;
+	if (!ReadResults(baselinePath, baseline) || !ReadResults(currentPath, current))
+		return -1;
+
+	printf("%-16s %9s %3s %12s %12s %8s\n", "case", "size", "a", "baseline us", "current us", "change");
+
+	int regressions = 0;
+	for (const Result& now : current)
+	{
+		for (const Result& before : baseline)
+		{
+			if (before.name != now.name || before.width != now.width || before.height != now.height || before.opacity != now.opacity)
+				continue;
+
+			//Medians are compared, a single slow repetition should not fail a run
+			double change = before.median > 0 ? now.median / before.median - 1 : 0;
+			bool regressed = change > threshold;
+
+			//Encoders also regress by writing more
+			double bytesChange = before.bytes > 0 ? now.bytes / before.bytes - 1 : 0;
+			bool bytesRegressed = bytesChange > threshold;
+			regressions += regressed || bytesRegressed;
+
+			char size[32];
+			sprintf_s(size, "%dx%d", now.width, now.height);
+			printf("%-16s %9s %3d %12.3f %12.3f %+7.1f%%%s\n", now.name.c_str(), size, now.opacity,
+				before.median, now.median, change * 100, regressed ? "  REGRESSION" : "");
+			if (before.bytes > 0)
+				printf("%-16s %9s %3s %10.0f B %10.0f B %+7.1f%%%s\n", "", "", "",
+					before.bytes, now.bytes, bytesChange * 100, bytesRegressed ? "  REGRESSION" : "");
+			break;
+		}
+	}
+
+	printf("%d regression%s beyond %.0f%%\n", regressions, regressions == 1 ? "" : "s", threshold * 100);
+	return regressions;
+}
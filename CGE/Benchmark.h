@@ -0,0 +1,59 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <vector>
+
+class CGE;
+
+class Benchmark
+{
+public:
+	//Times are per draw call in microseconds, opacity is the alpha the primitive was drawn with
+	struct Result
+	{
+		std::string name;
+		int width;
+		int height;
+		int opacity;
+		double median;
+		double minimum;
+		double mean;
+		int repetitions;
+		//Average output bytes per frame for encoders, 0 for everything else
+		double bytes = 0;
+	};
+
+	CGE* engine;
+	std::vector<Result> results;
+
+	Benchmark(CGE* engine);
+
+	void HierarchicalDepth(int layers = 64, int frames = 10);
+	void PresentThread(int frames = 300);
+	void JobScaling(int repetitions = 20);
+
+	//Every draw primitive plus clear and present at the engine's screen size, appended to results
+	void Primitives(int warmup = 5, int repetitions = 30);
+
+	//Wu anti-aliased line and circle against the aliased line and one pixel circle outline with the same layout,
+	//prints the cost per pixel touched and the ratio
+	void AntiAliasing(int warmup = 5, int repetitions = 30);
+
+	//A static scene redrawn every frame against the same scene cached in a layer and composited
+	void Layers(int warmup = 5, int repetitions = 30);
+	//Full redraws against retained frames that invalidate a few percent of the screen
+	void PartialRedraw(int warmup = 5, int repetitions = 30);
+	//Draws and resolves the same scene in every output mode, so the extra pixels can be weighed against their cost
+	void OutputModes(int warmup = 5, int repetitions = 30);
+	//Encodes an animated scene with each terminal presenter, times are per frame and bytes are recorded alongside
+	void TerminalEncoding(int frames = 120);
+
+	bool WriteResults(const std::string& filePath) const;
+	static bool ReadResults(const std::string& filePath, std::vector<Result>& results);
+
+	//Prints every case slower than baseline by more than threshold and returns how many there were, -1 if either file is unreadable
+	static int Compare(const std::string& baselinePath, const std::string& currentPath, float threshold = 0.1f);
+
+private:
+	void Time(const char* name, int opacity, int count, int warmup, int repetitions, const std::function<void(int)>& draw);
+};
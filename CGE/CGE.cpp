@@ -1,115 +1,248 @@
 #pragma once
 #include <math.h>
+#include <algorithm>
 #include "CGE.h"
 
-CGE::CGE(LPCWSTR title, const tVector2<int>& pixelSize, const tVector2<int>& screenSize, bool thirdDimension)
-{
-    hSTDout = GetStdHandle(STD_OUTPUT_HANDLE);
-    hSTDin = GetStdHandle(STD_INPUT_HANDLE);
-    consoleHwnd = GetConsoleWindow();
-    CONSOLE_FONT_INFOEX consoleFontInfo;
-    consoleFontInfo.cbSize = sizeof(consoleFontInfo);
-    consoleFontInfo.nFont = 0;
-    consoleFontInfo.dwFontSize.X = pixelSize.i;
-    consoleFontInfo.dwFontSize.Y = pixelSize.j;
-    consoleFontInfo.FontFamily = FF_DONTCARE;
-    consoleFontInfo.FontWeight = FW_NORMAL;
-    wcscpy_s(consoleFontInfo.FaceName, L"Terminal");
-    SetCurrentConsoleFontEx(hSTDout, 0, &consoleFontInfo);
-
-    CONSOLE_SCREEN_BUFFER_INFOEX screenBufferInfo;
-    screenBufferInfo.cbSize = sizeof(CONSOLE_SCREEN_BUFFER_INFOEX);
-    GetConsoleScreenBufferInfoEx(hSTDout, &screenBufferInfo);
-    for (int i = 0; i < 16; i++)
-    {
-        screenBufferInfo.ColorTable[i] = 
-            colourMap.consoleColours[i].r + 
-            colourMap.consoleColours[i].g * 256 + 
-            colourMap.consoleColours[i].b * 65536;
-    }
-    SetConsoleScreenBufferInfoEx(hSTDout, &screenBufferInfo);
-
-    COORD largestWindow = GetLargestConsoleWindowSize(hSTDout);
-    if (largestWindow.X < screenSize.i)
-        this->screenSize.i = largestWindow.X;
-    else
-        this->screenSize.i = screenSize.i;
+CGE::CGE(LPCWSTR title, const tVector2<int>& pixelSize, const tVector2<int>& screenSize, bool thirdDimension, Present_Mode presentMode)
+{
+    //Headless engines never touch the console, so the buffers get exactly the size asked for
+    headless = presentMode == Present_Headless;
+    this->screenSize = screenSize;
+    if (!headless)
+    {
+        hSTDout = GetStdHandle(STD_OUTPUT_HANDLE);
+        hSTDin = GetStdHandle(STD_INPUT_HANDLE);
+        consoleHwnd = GetConsoleWindow();
+        CONSOLE_FONT_INFOEX consoleFontInfo;
+        consoleFontInfo.cbSize = sizeof(consoleFontInfo);
+        consoleFontInfo.nFont = 0;
+        consoleFontInfo.dwFontSize.X = pixelSize.i;
+        consoleFontInfo.dwFontSize.Y = pixelSize.j;
+        consoleFontInfo.FontFamily = FF_DONTCARE;
+        consoleFontInfo.FontWeight = FW_NORMAL;
+        wcscpy_s(consoleFontInfo.FaceName, L"Terminal");
+        SetCurrentConsoleFontEx(hSTDout, 0, &consoleFontInfo);
+
+        CONSOLE_SCREEN_BUFFER_INFOEX screenBufferInfo;
+        screenBufferInfo.cbSize = sizeof(CONSOLE_SCREEN_BUFFER_INFOEX);
+        GetConsoleScreenBufferInfoEx(hSTDout, &screenBufferInfo);
+        for (int i = 0; i < 16; i++)
+        {
+            screenBufferInfo.ColorTable[i] = 
+                colourMap.consoleColours[i].r + 
+                colourMap.consoleColours[i].g * 256 + 
+                colourMap.consoleColours[i].b * 65536;
+        }
+        SetConsoleScreenBufferInfoEx(hSTDout, &screenBufferInfo);
 
-    if (largestWindow.Y < screenSize.j)
-        this->screenSize.j = largestWindow.Y;
-    else
-        this->screenSize.j = screenSize.j;
+        COORD largestWindow = GetLargestConsoleWindowSize(hSTDout);
+        if (largestWindow.X < screenSize.i)
+            this->screenSize.i = largestWindow.X;
+        else
+            this->screenSize.i = screenSize.i;
+
+        if (largestWindow.Y < screenSize.j)
+            this->screenSize.j = largestWindow.Y;
+        else
+            this->screenSize.j = screenSize.j;
 
-    SetConsoleScreenBufferSize(hSTDout, { (short)this->screenSize.i, (short)this->screenSize.j });
-    windowArea = { 0, 0, (short)this->screenSize.i - 1, (short)this->screenSize.j - 1 };
-    SetConsoleWindowInfo(hSTDout, TRUE, &windowArea);
+        SetConsoleScreenBufferSize(hSTDout, { (short)this->screenSize.i, (short)this->screenSize.j });
+        windowArea = { 0, 0, (short)this->screenSize.i - 1, (short)this->screenSize.j - 1 };
+        SetConsoleWindowInfo(hSTDout, TRUE, &windowArea);
 
-    GetConsoleScreenBufferInfoEx(hSTDout, &screenBufferInfo);
-    SetConsoleScreenBufferSize(hSTDout, {
-        screenBufferInfo.srWindow.Right - screenBufferInfo.srWindow.Left + 1,
-        screenBufferInfo.srWindow.Bottom - screenBufferInfo.srWindow.Top + 1 });
+        GetConsoleScreenBufferInfoEx(hSTDout, &screenBufferInfo);
+        SetConsoleScreenBufferSize(hSTDout, {
+            screenBufferInfo.srWindow.Right - screenBufferInfo.srWindow.Left + 1,
+            screenBufferInfo.srWindow.Bottom - screenBufferInfo.srWindow.Top + 1 });
 
-    DWORD newStyle = WS_CAPTION | DS_MODALFRAME | WS_MINIMIZEBOX | WS_SYSMENU;
-    SetWindowLongW(consoleHwnd, GWL_STYLE, newStyle);
-    SetWindowPos(consoleHwnd, NULL, 0, 0, 0, 0, SWP_FRAMECHANGED | SWP_NOSIZE | SWP_NOMOVE | SWP_NOZORDER | SWP_SHOWWINDOW);
+        DWORD newStyle = WS_CAPTION | DS_MODALFRAME | WS_MINIMIZEBOX | WS_SYSMENU;
+        SetWindowLongW(consoleHwnd, GWL_STYLE, newStyle);
+        SetWindowPos(consoleHwnd, NULL, 0, 0, 0, 0, SWP_FRAMECHANGED | SWP_NOSIZE | SWP_NOMOVE | SWP_NOZORDER | SWP_SHOWWINDOW);
+    }
 
     this->thirdDimension = thirdDimension;
-    screenBuffer.InitialiseBuffer(screenSize);
+    jobs = new Job_System();
+    assets = new Asset_Loader(jobs);
+    consoleSize = this->screenSize;
+    if (presentMode == Present_Console || headless)
+        colourMap.Load();
+    else
+    {
+        quantizer.Initialise(colourMap);
+        terminal = new Terminal_Presenter(hSTDout, consoleSize, presentMode, quantizer);
+    }
+    screenBuffer.InitialiseBuffer(this->screenSize);
+    ResetViewport();
     ResetBuffer();
 
     StartTimer();
 
-    titleManager = new std::thread([this]() 
-        {
-            while (engineActive) 
-            { 
-                UpdateTitle();
-                Sleep(1000);
-            } 
-        });
-
     SetTitle(title);
 }
 CGE::~CGE()
 {
-    delete titleManager;
+    delete recorder;
+    delete presentThread;
+    delete[] cellBuffer;
+    delete terminal;
+    delete assets;
+    delete jobs;
     delete gameTime;
 }
 
 void CGE::Startup() { }
 void CGE::Shutdown() { }
 void CGE::Update() { }
+void CGE::FixedUpdate() { }
+void CGE::Render(float alpha) { Update(); }
 void CGE::Run()
 {
+    if (fixedStep <= 0)
+    {
+        while (engineActive)
+        {
+            PROFILE_ZONE("Frame");
+
+            assets->Publish();
+            ResetBuffer();
+
+            {
+                PROFILE_ZONE("Update");
+                Update();
+            }
+
+            if (showHud)
+                DrawHud();
+
+            DrawBuffer();
+
+            {
+                PROFILE_ZONE("Wait");
+                frameLimiter.Wait();
+            }
+            UpdateTimer();
+        }
+        return;
+    }
+
+    double accumulator = 0;
     while (engineActive)
     {
+        PROFILE_ZONE("Frame");
+
+        assets->Publish();
+        accumulator += frameSeconds;
+
+        int steps = 0;
+        while (accumulator >= fixedStep && steps < maxFixedSteps)
+        {
+            PROFILE_ZONE("FixedUpdate");
+            FixedUpdate();
+            accumulator -= fixedStep;
+            steps++;
+        }
+
+        //Too far behind to catch up, drop the backlog instead of spiralling
+        if (accumulator >= fixedStep)
+            accumulator = 0;
+
         ResetBuffer();
 
-        Update();
+        {
+            PROFILE_ZONE("Render");
+            Render(accumulator / fixedStep);
+        }
+
+        if (showHud)
+            DrawHud();
 
         DrawBuffer();
 
+        {
+            PROFILE_ZONE("Wait");
+            frameLimiter.Wait();
+        }
         UpdateTimer();
     }
 }
 
+void CGE::SetFixedStep(float stepsPerSecond)
+{
+    fixedStep = stepsPerSecond > 0 ? 1.0f / stepsPerSecond : 0;
+}
+void CGE::SetFrameLimit(float framesPerSecond)
+{
+    frameLimiter.SetRate(framesPerSecond);
+}
+void CGE::SetJobWorkers(int workers, bool pinThreads)
+{
+    delete jobs;
+    jobs = new Job_System(workers, pinThreads);
+    assets->jobs = jobs;
+}
+
 void CGE::StartTimer()
 {
+    delete gameTime;
     gameTime = new Timer();
-    startTime = gameTime->elapsed() * 1000;
+    startTime = gameTime->elapsed();
+    statsTime = titleTime = startTime;
 }
 void CGE::UpdateTimer()
 {
-    endTime = gameTime->elapsed() * 1000;
-    currentDelta = endTime - startTime;
+    endTime = gameTime->elapsed();
+    frameSeconds = endTime - startTime;
     startTime = endTime;
-    frameTimes[currentFrame] = currentDelta;
+    frameTimes[currentFrame] = (float)(frameSeconds * 1000);
     currentFrame++;
-    currentFrame %= 10;
+    currentFrame %= 128;
+    frameCount++;
     deltaTime = 0;
-    for (int i = 0; i < 10; i++)
-        deltaTime += frameTimes[i];
+    for (int i = 1; i <= 10; i++)
+        deltaTime += frameTimes[(currentFrame + 128 - i) % 128];
     deltaTime *= 0.1f;
+
+    //Publish a few times a second, the title only once a second
+    if (endTime - statsTime >= 0.25)
+    {
+        statsTime = endTime;
+        PublishStats();
+    }
+    if (endTime - titleTime >= 1.0)
+    {
+        titleTime = endTime;
+        UpdateTitle();
+    }
+}
+
+void CGE::PublishStats()
+{
+    Frame_Stats stats;
+    stats.frameTime = deltaTime;
+    stats.fps = deltaTime > 0 ? 1000 / deltaTime : 0;
+
+    int count = frameCount < 128 ? frameCount : 128;
+    float sorted[128];
+    for (int i = 0; i < count; i++)
+        sorted[i] = frameTimes[i];
+    std::sort(sorted, sorted + count);
+    if (count)
+    {
+        stats.p50 = sorted[count * 50 / 100];
+        stats.p95 = sorted[count * 95 / 100];
+        stats.p99 = sorted[count * 99 / 100];
+    }
+
+#if defined(CGE_PROFILE)
+    for (const Profiler::Stage& stage : Profiler::Stages())
+    {
+        if (stats.stageCount == Frame_Stats::maxStages)
+            break;
+        stats.stages[stats.stageCount++] = { stage.name, stage.p50, stage.p95, stage.p99 };
+    }
+#endif
+
+    frameStats.Publish(stats);
 }
 
 void CGE::SetTitle(LPCWSTR title)
@@ -130,7 +263,8 @@ void CGE::SetTitle(LPCWSTR title)
 }
 void CGE::UpdateTitle()
 {
-    int fps = 1000 / max(deltaTime, 1);
+    int fps = (int)frameStats.Read().fps;
+    if (fps > 9999) fps = 9999;
     char fpsText[5];
     sprintf_s(fpsText, "%d", fps);
     for (int i = 0; i < 5; i++)
@@ -142,16 +276,270 @@ void CGE::UpdateTitle()
 
 void CGE::DrawBuffer()
 {
-   WriteConsoleOutput(hSTDout, screenBuffer.charBuffer, { (short)screenSize.i, (short)screenSize.j }, { 0, 0 }, &windowArea);
+    PROFILE_ZONE("Present");
+    SetRenderTarget(nullptr);
+#if defined(CGE_COUNTERS)
+    FinishCounters();
+#endif
+    if (terminal)
+    {
+        terminal->Present(screenBuffer.pixelBuffer, screenSize, outputMode);
+        return;
+    }
+
+    CHAR_INFO* frame = screenBuffer.charBuffer;
+    if (cellBuffer)
+    {
+        Resolve();
+        frame = cellBuffer;
+    }
+
+    if (recorder)
+        recorder->Record(frame);
+    if (headless)
+        return;
+    if (presentThread)
+    {
+        //The returned slot is two frames old, retained mode only redraws what changed so it needs this frame's cells.
+        //Resolve rewrites every cell so the other output modes don't care
+        CHAR_INFO* submitted = frame;
+        frame = presentThread->Submit(frame);
+        if (retainedMode && !cellBuffer)
+            memcpy(frame, submitted, sizeof(CHAR_INFO) * consoleSize.i * consoleSize.j);
+        if (cellBuffer) cellBuffer = frame;
+        else screenBuffer.charBuffer = frame;
+    }
+    else
+        WriteConsoleOutput(hSTDout, frame, { (short)consoleSize.i, (short)consoleSize.j }, { 0, 0 }, &windowArea);
+}
+void CGE::PresentCells(const CHAR_INFO* cells)
+{
+    if (terminal || headless)
+        return;
+    WriteConsoleOutput(hSTDout, cells, { (short)consoleSize.i, (short)consoleSize.j }, { 0, 0 }, &windowArea);
+}
+void CGE::SetOutputMode(Output_Mode mode)
+{
+    SetRenderTarget(nullptr);
+    bool presenting = presentThread != nullptr;
+    SetPresentThread(false);
+
+    outputMode = mode;
+    tVector2<int> cellSize = Cell_Quantizer::CellSize(mode);
+    screenSize = { consoleSize.i * cellSize.i, consoleSize.j * cellSize.j };
+    screenBuffer.ReleaseBuffer();
+    screenBuffer.InitialiseBuffer(screenSize);
+
+    delete[] cellBuffer;
+    cellBuffer = nullptr;
+    if (terminal)
+        terminal->Invalidate();
+    else if (mode != Output_Shade)
+    {
+        int consoleArea = consoleSize.i * consoleSize.j;
+        cellBuffer = new CHAR_INFO[consoleArea];
+        ZeroMemory(cellBuffer, sizeof(CHAR_INFO) * consoleArea);
+        quantizer.Initialise(colourMap);
+    }
+
+    ResetViewport();
+    if (retainedMode)
+        InvalidateAll();
+    ResetBuffer();
+    SetPresentThread(presenting);
+}
+void CGE::Resolve()
+{
+    PROFILE_ZONE("Resolve");
+    if (jobs->WorkerCount() && screenSize.i * screenSize.j >= 16384)
+        jobs->ParallelFor(0, consoleSize.j, 8, [this](int first, int last) { ResolveRows(first, last); });
+    else
+        ResolveRows(0, consoleSize.j);
+}
+void CGE::ResolveRows(int first, int last)
+{
+    //Console rows count down from the top, pixel rows up from the bottom
+    tVector2<int> cellSize = Cell_Quantizer::CellSize(outputMode);
+    const wchar_t* glyphs = outputMode == Output_Braille ? quantizer.brailleGlyphs : quantizer.quadrantGlyphs;
+    for (int row = first; row < last; row++)
+    {
+        CHAR_INFO* cells = cellBuffer + consoleSize.i * row;
+        const Colour* top = screenBuffer.pixelBuffer + screenSize.i * (screenSize.j - 1 - row * cellSize.j);
+        if (outputMode == Output_HalfBlock)
+        {
+            const Colour* bottom = top - screenSize.i;
+            for (int column = 0; column < consoleSize.i; column++)
+                cells[column] = quantizer.HalfBlock(top[column], bottom[column]);
+            continue;
+        }
+
+        //Gathered top row first to match the pattern bits
+        Colour pixels[8];
+        for (int column = 0; column < consoleSize.i; column++)
+        {
+            const Colour* source = top + column * cellSize.i;
+            for (int h = 0; h < cellSize.j; h++, source -= screenSize.i)
+                for (int w = 0; w < cellSize.i; w++)
+                    pixels[h * cellSize.i + w] = source[w];
+            cells[column] = quantizer.Pattern(pixels, cellSize.i * cellSize.j, glyphs);
+        }
+    }
+}
+void CGE::SetPresentThread(bool enabled)
+{
+    //Terminal frames are written as they are encoded, headless ones never leave the buffers
+    if (terminal || headless)
+        return;
+    if (enabled && !presentThread)
+        presentThread = new Present_Thread(hSTDout, consoleSize, windowArea, cellBuffer ? cellBuffer : screenBuffer.charBuffer);
+    else if (!enabled && presentThread)
+    {
+        delete presentThread;
+        presentThread = nullptr;
+    }
+}
+bool CGE::StartRecording(const std::string& filePath)
+{
+    //Recordings hold console cells, which terminal presenters never make
+    if (terminal)
+        return false;
+    if (!recorder)
+        recorder = new Frame_Recorder();
+    return recorder->Start(filePath, consoleSize);
+}
+void CGE::StopRecording()
+{
+    delete recorder;
+    recorder = nullptr;
+}
+static int Area(const CGE::Clip_Rect& rect)
+{
+    return (rect.right - rect.left) * (rect.top - rect.bottom);
+}
+static CGE::Clip_Rect Bounds(const CGE::Clip_Rect& a, const CGE::Clip_Rect& b)
+{
+    return { min(a.left, b.left), min(a.bottom, b.bottom), max(a.right, b.right), max(a.top, b.top) };
+}
+//Clamps to the screen then merges until no two rectangles overlap, so nothing is cleared or drawn twice.
+//Pairs whose bounding box costs no extra pixels are merged too, past limit the pair wasting the fewest pixels goes next
+static void MergeRects(std::vector<CGE::Clip_Rect>& rects, const tVector2<int>& screenSize, size_t limit)
+{
+    size_t kept = 0;
+    for (CGE::Clip_Rect rect : rects)
+    {
+        rect = { max(rect.left, 0), max(rect.bottom, 0), min(rect.right, screenSize.i), min(rect.top, screenSize.j) };
+        if (rect.left < rect.right && rect.bottom < rect.top)
+            rects[kept++] = rect;
+    }
+    rects.resize(kept);
+
+    while (rects.size() > 1)
+    {
+        bool found = false;
+        size_t first = 0, second = 0;
+        int leastWaste = 0;
+        for (size_t i = 0; i < rects.size() && !found; i++)
+        {
+            for (size_t j = i + 1; j < rects.size() && !found; j++)
+            {
+                const CGE::Clip_Rect& a = rects[i];
+                const CGE::Clip_Rect& b = rects[j];
+                int waste = Area(Bounds(a, b)) - Area(a) - Area(b);
+                found = waste <= 0 || (a.left < b.right && b.left < a.right && a.bottom < b.top && b.bottom < a.top);
+                if (found || (i == 0 && j == 1) || waste < leastWaste)
+                {
+                    first = i;
+                    second = j;
+                    leastWaste = waste;
+                }
+            }
+        }
+
+        if (!found && rects.size() <= limit)
+            break;
+        rects[first] = Bounds(rects[first], rects[second]);
+        rects.erase(rects.begin() + second);
+    }
 }
 void CGE::ResetBuffer()
 {
-    if (thirdDimension) screenBuffer.ResetBuffer3D(screenSize);
+    PROFILE_ZONE("Clear");
+    if (retainedMode)
+    {
+        MergeRects(invalidRects, screenSize, maxRedrawRects);
+        redrawRects.swap(invalidRects);
+        invalidRects.clear();
+        for (const Clip_Rect& rect : redrawRects)
+            screenBuffer.ResetRect(screenSize, rect.left, rect.bottom, rect.right, rect.top, thirdDimension);
+        screenBuffer.ResetEdgeBuffer(screenSize.j);
+#if defined(CGE_COUNTERS)
+        screenBuffer.ResetOverdrawBuffer(screenSize.i * screenSize.j);
+        drawCounters.Reset();
+#endif
+        return;
+    }
+
+    if (jobs->WorkerCount() && screenSize.i * screenSize.j >= 16384)
+    {
+        jobs->ParallelFor(0, screenSize.j, 16, [this](int first, int last) { screenBuffer.ResetRows(screenSize, first, last); });
+        screenBuffer.ResetEdgeBuffer(screenSize.j);
+        if (thirdDimension) screenBuffer.ResetDepthBuffer(screenSize.i * screenSize.j);
+    }
+    else if (thirdDimension) screenBuffer.ResetBuffer3D(screenSize);
     else screenBuffer.ResetBuffer2D(screenSize);
+#if defined(CGE_COUNTERS)
+    screenBuffer.ResetOverdrawBuffer(screenSize.i * screenSize.j);
+    drawCounters.Reset();
+#endif
+}
+void CGE::FinishCounters()
+{
+    int screenArea = screenSize.i * screenSize.j;
+    drawCounters.pixelsCovered = 0;
+    for (int i = 0; i < screenArea; i++)
+        drawCounters.pixelsCovered += screenBuffer.overdrawBuffer[i] != 0;
+    frameCounters = drawCounters;
+
+    if (!overdrawView)
+        return;
+
+    //Replace the scene with a heatmap of how many times each pixel was written
+    const Colour heat[8] = { BLACK, DARK_BLUE, BLUE, GREEN, YELLOW, ORANGE, RED, WHITE };
+    for (int h = 0; h < screenSize.j; h++)
+    {
+        for (int w = 0; w < screenSize.i; w++)
+        {
+            int writes = screenBuffer.overdrawBuffer[screenSize.i * h + w];
+            const Colour& colour = heat[writes < 7 ? writes : 7];
+            screenBuffer.pixelBuffer[screenSize.i * h + w] = colour;
+            screenBuffer.charBuffer[screenSize.i * (screenSize.j - h - 1) + w] = GetCharInfo(colour);
+        }
+    }
 }
 void CGE::SetBuffer(Colour colour)
 {
+    PROFILE_ZONE("Clear");
     colour.a = 255;
+    CHAR_INFO pixel = GetCharInfo(colour);
+
+    //Only the clip is filled when it doesn't cover the screen, so clearing inside Redraw keeps the rest of a retained frame
+    if (clip.left > 0 || clip.bottom > 0 || clip.right < screenSize.i || clip.top < screenSize.j)
+    {
+        for (int h = clip.bottom; h < clip.top; h++)
+        {
+            Colour* pixels = screenBuffer.pixelBuffer + screenSize.i * h;
+            CHAR_INFO* chars = screenBuffer.charBuffer + screenSize.i * (screenSize.j - h - 1);
+            for (int w = clip.left; w < clip.right; w++)
+            {
+                pixels[w] = colour;
+                chars[w] = pixel;
+            }
+        }
+        if (thirdDimension && clip.left < clip.right && clip.bottom < clip.top)
+            screenBuffer.depthBuffer.ResetRect(screenSize, clip.left, clip.bottom, clip.right, clip.top);
+        return;
+    }
+
     if (thirdDimension)
     {
         screenBuffer.SetPixelBuffer(screenSize.i * screenSize.j, colour);
@@ -164,7 +552,19 @@ void CGE::SetBuffer(Colour colour)
         screenBuffer.ResetEdgeBuffer(screenSize.j);
     }
 
+    screenBuffer.SetCharBuffer(screenSize.i * screenSize.j, pixel);
+}
+
+CHAR_INFO CGE::GetCharInfo(const Colour& colour)
+{
     CHAR_INFO pixel;
+    if (!colourMap.colourCube)
+    {
+        pixel.Char.UnicodeChar = L' ';
+        pixel.Attributes = 0;
+        return pixel;
+    }
+
     pixel.Attributes = colourMap.colourCube[colour.r + colour.g * 256 + colour.b * 65536] & 0xFF;
     switch (colourMap.colourCube[colour.r + colour.g * 256 + colour.b * 65536] >> 8)
     {
@@ -181,128 +581,628 @@ void CGE::SetBuffer(Colour colour)
         pixel.Char.UnicodeChar = L'\x2591';
         break;
     }
+    return pixel;
+}
 
-    screenBuffer.SetCharBuffer(screenSize.i * screenSize.j, pixel);
+void CGE::SetRenderTarget(Render_Target* target)
+{
+    if (target == renderTarget)
+        return;
+
+    //Draw calls only know screenBuffer and screenSize, so the target's buffers are swapped in and later swapped back out
+    if (renderTarget)
+    {
+        screenBuffer.Swap(renderTarget->buffer);
+        std::swap(screenSize, renderTarget->size);
+    }
+    else
+    {
+        screenViewport = viewport;
+        screenClip = clip;
+        screenClipStack.swap(clipStack);
+    }
+
+    renderTarget = target;
+    if (renderTarget)
+    {
+        screenBuffer.Swap(renderTarget->buffer);
+        std::swap(screenSize, renderTarget->size);
+        ResetViewport();
+    }
+    else
+    {
+        viewport = screenViewport;
+        clip = screenClip;
+        clipStack.swap(screenClipStack);
+        screenClipStack.clear();
+    }
+}
+bool CGE::UpdateLayer(Render_Target& layer, const std::function<void()>& draw)
+{
+    if (!layer.invalid)
+        return false;
+
+    PROFILE_ZONE("UpdateLayer");
+    Render_Target* previous = renderTarget;
+    if (previous == &layer)
+        SetRenderTarget(nullptr);
+
+    layer.Clear();
+    SetRenderTarget(&layer);
+    draw();
+    SetRenderTarget(previous == &layer ? nullptr : previous);
+
+    layer.UpdateOpacity();
+    layer.invalid = false;
+    return true;
+}
+void CGE::Composite(const Render_Target& layer, int x, int y, Composite_Mode mode, int opacity)
+{
+    PROFILE_ZONE("Composite");
+    COUNT_DRAW(Layer);
+
+    if (opacity <= 0 || &layer == renderTarget)
+        return;
+    if (opacity > 255)
+        opacity = 255;
+
+    //Clipped once, every row below is already inside the clip
+    x += viewport.left;
+    y += viewport.bottom;
+    int left = max(x, clip.left), right = min(x + layer.size.i, clip.right);
+    int bottom = max(y, clip.bottom), top = min(y + layer.size.j, clip.top);
+    if (left >= right || bottom >= top)
+        return;
+
+    if (mode == Composite_Alpha && layer.opaque && opacity == 255)
+        mode = Composite_Copy;
+
+    int width = right - left;
+    for (int h = bottom; h < top; h++)
+    {
+        int row = h - y;
+        const Colour* source = layer.buffer.pixelBuffer + layer.size.i * row + (left - x);
+        const CHAR_INFO* sourceChars = layer.buffer.charBuffer + layer.size.i * (layer.size.j - row - 1) + (left - x);
+        Colour* pixels = screenBuffer.pixelBuffer + screenSize.i * h + left;
+        CHAR_INFO* chars = screenBuffer.charBuffer + screenSize.i * (screenSize.j - h - 1) + left;
+
+        if (mode == Composite_Copy)
+        {
+            memcpy(pixels, source, sizeof(Colour) * width);
+            if (layer.ownsPixels)
+                memcpy(chars, sourceChars, sizeof(CHAR_INFO) * width);
+            else
+                for (int w = 0; w < width; w++)
+                    chars[w] = GetCharInfo(source[w]);
+#if defined(CGE_COUNTERS)
+            drawCounters.pixelsWritten += width;
+            for (int w = 0; w < width; w++)
+                COUNT_OVERDRAW(screenSize.i * h + left + w);
+#endif
+            continue;
+        }
+
+        for (int w = 0; w < width; w++)
+        {
+            int alpha = source[w].a * opacity / 255;
+            if (alpha == 0)
+                continue;
+            COUNT_PIXEL(pixelsWritten);
+            COUNT_OVERDRAW(screenSize.i * h + left + w);
+
+            if (mode == Composite_Alpha && alpha == 255)
+            {
+                pixels[w] = source[w];
+                chars[w] = layer.ownsPixels ? sourceChars[w] : GetCharInfo(source[w]);
+                continue;
+            }
+
+            COUNT_PIXEL(pixelsBlended);
+            Colour& destination = pixels[w];
+            if (mode == Composite_Add)
+            {
+                destination = Colour(
+                    min(destination.r + source[w].r * alpha / 255, 255),
+                    min(destination.g + source[w].g * alpha / 255, 255),
+                    min(destination.b + source[w].b * alpha / 255, 255),
+                    (int)destination.a);
+            }
+            else
+            {
+                int inverse = 255 - alpha;
+                destination = Colour(
+                    (source[w].r * alpha + destination.r * inverse + 127) / 255,
+                    (source[w].g * alpha + destination.g * inverse + 127) / 255,
+                    (source[w].b * alpha + destination.b * inverse + 127) / 255,
+                    destination.a + (255 - destination.a) * alpha / 255);
+            }
+            chars[w] = GetCharInfo(destination);
+        }
+    }
+}
+
+void CGE::SetViewport(int x, int y, int width, int height)
+{
+    viewport = { x, y, x + width, y + height };
+    clip = { max(x, 0), max(y, 0), min(x + width, screenSize.i), min(y + height, screenSize.j) };
+    clipStack.clear();
+
+    //A viewport set while redrawing stays inside the rectangle being redrawn, render targets are never limited
+    if (redrawing && !renderTarget)
+        clip = { max(clip.left, redrawing->left), max(clip.bottom, redrawing->bottom), min(clip.right, redrawing->right), min(clip.top, redrawing->top) };
+}
+void CGE::ResetViewport()
+{
+    SetViewport(0, 0, screenSize.i, screenSize.j);
+}
+void CGE::PushClip(int x, int y, int width, int height)
+{
+    clipStack.push_back(clip);
+    x += viewport.left;
+    y += viewport.bottom;
+    clip = { max(x, clip.left), max(y, clip.bottom), min(x + width, clip.right), min(y + height, clip.top) };
+}
+void CGE::PopClip()
+{
+    if (clipStack.empty())
+        return;
+    clip = clipStack.back();
+    clipStack.pop_back();
+}
+
+void CGE::SetRetainedMode(bool enabled)
+{
+    retainedMode = enabled;
+    invalidRects.clear();
+    redrawRects.clear();
+    if (enabled)
+        InvalidateAll();
+}
+void CGE::Invalidate(int x, int y, int width, int height)
+{
+    if (width > 0 && height > 0)
+        invalidRects.push_back({ x + viewport.left, y + viewport.bottom, x + viewport.left + width, y + viewport.bottom + height });
+}
+void CGE::InvalidateAll()
+{
+    invalidRects.clear();
+    invalidRects.push_back({ 0, 0, screenSize.i, screenSize.j });
+}
+bool CGE::Redraw(const std::function<void()>& draw)
+{
+    if (!retainedMode)
+    {
+        draw();
+        return true;
+    }
+    if (redrawRects.empty())
+        return false;
+
+    PROFILE_ZONE("Redraw");
+    Clip_Rect gameViewport = viewport, gameClip = clip;
+    std::vector<Clip_Rect> gameStack;
+    gameStack.swap(clipStack);
+
+    for (const Clip_Rect& rect : redrawRects)
+    {
+        //Every pass sees the same viewport, only the clip changes
+        redrawing = &rect;
+        viewport = gameViewport;
+        clip = { max(gameClip.left, rect.left), max(gameClip.bottom, rect.bottom), min(gameClip.right, rect.right), min(gameClip.top, rect.top) };
+        clipStack.clear();
+        if (clip.left < clip.right && clip.bottom < clip.top)
+            draw();
+    }
+
+    redrawing = nullptr;
+    viewport = gameViewport;
+    clip = gameClip;
+    clipStack.swap(gameStack);
+    return true;
 }
 
 void CGE::SetPixel(const tVector2<int>& position, const Colour& colour)
 {
     if (colour.a == 0)
+    {
+        COUNT_PIXEL(pixelsTransparent);
         return;
+    }
 
-    if (position.i < 0 || position.i >= screenSize.i)
-        return;
-    if (position.j < 0 || position.j >= screenSize.j)
+    int x = position.i + viewport.left, y = position.j + viewport.bottom;
+    if (x < clip.left || x >= clip.right || y < clip.bottom || y >= clip.top)
+    {
+        COUNT_PIXEL(pixelsClipped);
         return;
+    }
 
+    WritePixel(x, y, colour);
+}
+void CGE::WritePixel(int x, int y, const Colour& colour)
+{
+    int index = screenSize.i * y + x;
     Colour newColour;
     if (colour.a == 255)
         newColour = colour;
     else
-        newColour = colour + screenBuffer.pixelBuffer[screenSize.i * position.j + position.i];
-
-    screenBuffer.pixelBuffer[screenSize.i * position.j + position.i] = newColour;
-    CHAR_INFO& pixel = screenBuffer.charBuffer[screenSize.i * (screenSize.j - position.j - 1) + position.i];
-    pixel.Attributes = colourMap.colourCube[newColour.r + newColour.g * 256 + newColour.b * 65536] & 0xFF;
-    switch (colourMap.colourCube[newColour.r + newColour.g * 256 + newColour.b * 65536] >> 8)
     {
-    case 0:
-        pixel.Char.UnicodeChar = L'\x2588';
-        break;
-    case 1:
-        pixel.Char.UnicodeChar = L'\x2593';
-        break;
-    case 2:
-        pixel.Char.UnicodeChar = L'\x2592';
-        break;
-    case 3:
-        pixel.Char.UnicodeChar = L'\x2591';
-        break;
+        newColour = colour + screenBuffer.pixelBuffer[index];
+        COUNT_PIXEL(pixelsBlended);
     }
+    COUNT_PIXEL(pixelsWritten);
+    COUNT_OVERDRAW(index);
+
+    screenBuffer.pixelBuffer[index] = newColour;
+    screenBuffer.charBuffer[screenSize.i * (screenSize.j - y - 1) + x] = GetCharInfo(newColour);
 }
 void CGE::SetPixel(const Point2D& point)
 {
     if (point.colour.a == 0)
+    {
+        COUNT_PIXEL(pixelsTransparent);
+        return;
+    }
+
+    int x = (int)point.position.i + viewport.left, y = (int)point.position.j + viewport.bottom;
+    if (x < clip.left || x >= clip.right || y < clip.bottom || y >= clip.top)
+    {
+        COUNT_PIXEL(pixelsClipped);
         return;
+    }
 
     Colour newColour;
     if (point.colour.a == 255)
         newColour = point.colour;
     else
-        newColour = point.colour + screenBuffer.pixelBuffer[(int)(screenSize.i * point.position.j + point.position.i)];
-
-    screenBuffer.pixelBuffer[(int)(screenSize.i * point.position.j + point.position.i)] = newColour;
-    CHAR_INFO& pixel = screenBuffer.charBuffer[(int)(screenSize.i * (screenSize.j - point.position.j - 1) + point.position.i)];
-    pixel.Attributes = colourMap.colourCube[newColour.r + newColour.g * 256 + newColour.b * 65536] & 0xFF;
-    switch (colourMap.colourCube[newColour.r + newColour.g * 256 + newColour.b * 65536] >> 8)
     {
-    case 0:
-        pixel.Char.UnicodeChar = L'\x2588';
-        break;
-    case 1:
-        pixel.Char.UnicodeChar = L'\x2593';
-        break;
-    case 2:
-        pixel.Char.UnicodeChar = L'\x2592';
-        break;
-    case 3:
-        pixel.Char.UnicodeChar = L'\x2591';
-        break;
+        newColour = point.colour + screenBuffer.pixelBuffer[screenSize.i * y + x];
+        COUNT_PIXEL(pixelsBlended);
     }
+    COUNT_PIXEL(pixelsWritten);
+    COUNT_OVERDRAW(screenSize.i * y + x);
+
+    screenBuffer.pixelBuffer[screenSize.i * y + x] = newColour;
+    screenBuffer.charBuffer[screenSize.i * (screenSize.j - y - 1) + x] = GetCharInfo(newColour);
 }
 
 void CGE::DrawLine(tVector2<int> position1, tVector2<int> position2, const Colour& colour)
 {
-    short dx = abs(position2.i - position1.i);
-    short sx = position1.i < position2.i ? 1 : -1;
-    short dy = -abs(position2.j - position1.j);
-    short sy = position1.j < position2.j ? 1 : -1;
-    short err = dx + dy;
-    while (true)
+    PROFILE_ZONE("DrawLine");
+    COUNT_DRAW(Line);
+
+    if (colour.a == 0)
+        return;
+
+    CHAR_INFO glyph = GetCharInfo(colour);
+    RasterLine(position1.i + viewport.left, position1.j + viewport.bottom, position2.i + viewport.left, position2.j + viewport.bottom,
+        colour, colour.a == 255 ? &glyph : nullptr, false);
+}
+void CGE::DrawLine(Line line, const Colour& colour)
+{
+    DrawLine(tVector2<int>{ (int)line.point[0].i, (int)line.point[0].j }, tVector2<int>{ (int)line.point[1].i, (int)line.point[1].j }, colour);
+}
+void CGE::DrawPolyline(const Vector2* points, size_t count, const Colour& colour)
+{
+    PROFILE_ZONE("DrawPolyline");
+    COUNT_DRAW(Line);
+
+    if (colour.a == 0 || count == 0)
+        return;
+
+    //Shared joints are only drawn by the segment they start, so translucent polylines blend each pixel once
+    CHAR_INFO glyph = GetCharInfo(colour);
+    const CHAR_INFO* opaque = colour.a == 255 ? &glyph : nullptr;
+    int ox = viewport.left, oy = viewport.bottom;
+    if (count == 1)
+        RasterLine((int)points[0].i + ox, (int)points[0].j + oy, (int)points[0].i + ox, (int)points[0].j + oy, colour, opaque, false);
+    for (size_t i = 1; i < count; i++)
+        RasterLine((int)points[i - 1].i + ox, (int)points[i - 1].j + oy, (int)points[i].i + ox, (int)points[i].j + oy, colour, opaque, i > 1);
+}
+//(a * b + c) / d and its remainder for non-negative values. Endpoints a few billion pixels apart overflow a * b,
+//so those take the product a bit of b at a time, keeping the partial remainder below d
+static long long MulDiv(long long a, long long b, long long c, long long d, long long& remainder)
+{
+    if (a < (1ll << 31) && b < (1ll << 31))
+    {
+        remainder = (a * b + c) % d;
+        return (a * b + c) / d;
+    }
+
+    long long quotient = (a / d) * b + c / d;
+    a %= d;
+    remainder = c % d;
+    long long partial = 0, partialRemainder = 0;
+    for (int bit = 62; bit >= 0; bit--)
     {
-        SetPixel(position1, colour);
-        if ((int)position1.i == (int)position2.i && (int)position1.j == (int)position2.j) break;
-        short e2 = 2 * err;
-        if (e2 >= dy)
+        partial *= 2;
+        partialRemainder *= 2;
+        if (partialRemainder >= d) { partialRemainder -= d; partial++; }
+        if (b >> bit & 1)
         {
-            err += dy;
-            position1.i += sx;
+            partialRemainder += a;
+            if (partialRemainder >= d) { partialRemainder -= d; partial++; }
         }
-        if (e2 <= dx)
+    }
+
+    quotient += partial;
+    remainder += partialRemainder;
+    if (remainder >= d) { remainder -= d; quotient++; }
+    return quotient;
+}
+void CGE::RasterLine(int x0, int y0, int x1, int y1, const Colour& colour, const CHAR_INFO* glyph, bool skipFirst)
+{
+    long long dx = (long long)x1 - x0;
+    long long dy = (long long)y1 - y0;
+
+    //Liang-Barsky against the clip rectangle grown by half a pixel, the rounding boundary of the minor axis
+    double t0 = 0, t1 = 1;
+    double p[4] = { (double)-dx, (double)dx, (double)-dy, (double)dy };
+    double q[4] = { x0 - clip.left + 0.5, clip.right - 0.5 - x0, y0 - clip.bottom + 0.5, clip.top - 0.5 - y0 };
+    for (int i = 0; i < 4; i++)
+    {
+        if (p[i] == 0)
         {
-            err += dx;
-            position1.j += sy;
+            if (q[i] < 0)
+                return;
+            continue;
+        }
+
+        double t = q[i] / p[i];
+        if (p[i] < 0)
+        {
+            if (t > t1) return;
+            if (t > t0) t0 = t;
+        }
+        else
+        {
+            if (t < t0) return;
+            if (t < t1) t1 = t;
+        }
+    }
+
+    //Step k along the major axis puts the minor axis at round(k * minor / major), kept exact with an integer remainder.
+    //major and minor need 33 bits, so 2 * k * minor goes through MulDiv
+    bool steep = (dy < 0 ? -dy : dy) > (dx < 0 ? -dx : dx);
+    long long major = steep ? dy : dx;
+    long long minor = steep ? dx : dy;
+    int majorStep = major < 0 ? -1 : 1;
+    int minorStep = minor < 0 ? -1 : 1;
+    major = major < 0 ? -major : major;
+    minor = minor < 0 ? -minor : minor;
+    long long denominator = major ? 2 * major : 1;
+
+    auto at = [&](long long k, int& x, int& y)
+    {
+        int majorOffset = (int)(k * majorStep);
+        long long remainder;
+        int minorOffset = (int)MulDiv(2 * minor, k, major, denominator, remainder) * minorStep;
+        x = x0 + (steep ? minorOffset : majorOffset);
+        y = y0 + (steep ? majorOffset : minorOffset);
+        return x >= clip.left && x < clip.right && y >= clip.bottom && y < clip.top;
+    };
+
+    long long first = (long long)ceil(t0 * major);
+    long long last = (long long)floor(t1 * major);
+    if (skipFirst && first == 0)
+        first = 1;
+
+    //Exact half pixel ties can land one step outside, pull the ends in until they are inside the clip
+    int x, y;
+    while (first <= last && !at(first, x, y))
+        first++;
+    while (last >= first && !at(last, x, y))
+        last--;
+    if (first > last)
+        return;
+
+    at(first, x, y);
+    long long remainder;
+    MulDiv(2 * minor, first, major, denominator, remainder);
+    int pixelStep = steep ? (majorStep * screenSize.i) : majorStep;
+    int charStep = steep ? (-majorStep * screenSize.i) : majorStep;
+    int pixelMinorStep = steep ? minorStep : (minorStep * screenSize.i);
+    int charMinorStep = steep ? minorStep : (-minorStep * screenSize.i);
+    int pixelIndex = screenSize.i * y + x;
+    int charIndex = screenSize.i * (screenSize.j - y - 1) + x;
+
+    //Everything from first to last is inside the clip, so no per pixel bounds checks
+    for (long long k = first; k <= last; k++)
+    {
+        if (glyph)
+        {
+            COUNT_PIXEL(pixelsWritten);
+            COUNT_OVERDRAW(pixelIndex);
+            screenBuffer.pixelBuffer[pixelIndex] = colour;
+            screenBuffer.charBuffer[charIndex] = *glyph;
+        }
+        else
+        {
+            Colour newColour = colour + screenBuffer.pixelBuffer[pixelIndex];
+            COUNT_PIXEL(pixelsBlended);
+            COUNT_PIXEL(pixelsWritten);
+            COUNT_OVERDRAW(pixelIndex);
+            screenBuffer.pixelBuffer[pixelIndex] = newColour;
+            screenBuffer.charBuffer[charIndex] = GetCharInfo(newColour);
+        }
+
+        pixelIndex += pixelStep;
+        charIndex += charStep;
+        remainder += 2 * minor;
+        if (remainder >= denominator)
+        {
+            remainder -= denominator;
+            pixelIndex += pixelMinorStep;
+            charIndex += charMinorStep;
         }
     }
 }
-void CGE::DrawLine(Line line, const Colour& colour)
+static Colour Blend(const Colour& colour, const Colour& destination, int alpha)
+{
+    int inverse = 255 - alpha;
+    return Colour(
+        (colour.r * alpha + destination.r * inverse + 127) / 255,
+        (colour.g * alpha + destination.g * inverse + 127) / 255,
+        (colour.b * alpha + destination.b * inverse + 127) / 255,
+        destination.a + (255 - destination.a) * alpha / 255);
+}
+void CGE::BlendPixel(int x, int y, const Colour& colour, int coverage)
+{
+    if (x < clip.left || x >= clip.right || y < clip.bottom || y >= clip.top)
+        return;
+
+    int alpha = colour.a * coverage / 255;
+    if (alpha == 0)
+        return;
+
+    int index = screenSize.i * y + x;
+    Colour& destination = screenBuffer.pixelBuffer[index];
+    Colour newColour = Blend(colour, destination, alpha);
+    COUNT_PIXEL(pixelsBlended);
+    COUNT_PIXEL(pixelsWritten);
+    COUNT_OVERDRAW(index);
+
+    destination = newColour;
+    screenBuffer.charBuffer[screenSize.i * (screenSize.j - y - 1) + x] = GetCharInfo(newColour);
+}
+void CGE::BlendSpan(int y, int x0, int x1, const Colour& colour, const unsigned char* coverage)
 {
-    line.point[0] = (tVector2<int>)line.point[0];
-    line.point[1] = (tVector2<int>)line.point[1];
-    short dx = abs(line.point[1].i - line.point[0].i);
-    short sx = line.point[0].i < line.point[1].i ? 1 : -1;
-    short dy = -abs(line.point[1].j - line.point[0].j);
-    short sy = line.point[0].j < line.point[1].j ? 1 : -1;
-    short err = dx + dy;
-    while (true)
+    if (y < clip.bottom || y >= clip.top)
+        return;
+    if (x0 < clip.left)
+    {
+        coverage += clip.left - x0;
+        x0 = clip.left;
+    }
+    if (x1 > clip.right - 1) x1 = clip.right - 1;
+
+    Colour* pixels = screenBuffer.pixelBuffer + screenSize.i * y;
+    CHAR_INFO* chars = screenBuffer.charBuffer + screenSize.i * (screenSize.j - y - 1);
+    for (int x = x0; x <= x1; x++, coverage++)
+    {
+        int alpha = colour.a * *coverage / 255;
+        if (alpha == 0)
+            continue;
+
+        COUNT_PIXEL(pixelsBlended);
+        COUNT_PIXEL(pixelsWritten);
+        COUNT_OVERDRAW(screenSize.i * y + x);
+        pixels[x] = Blend(colour, pixels[x], alpha);
+        chars[x] = GetCharInfo(pixels[x]);
+    }
+}
+void CGE::DrawLineAA(Vector2 position1, Vector2 position2, const Colour& colour)
+{
+    PROFILE_ZONE("DrawLineAA");
+    COUNT_DRAW(Line);
+
+    if (colour.a == 0)
+        return;
+
+    //Pixel x covers [x, x + 1) like the truncating DrawLine, Wu works on pixel centres
+    float x0 = position1.i + viewport.left - 0.5f, y0 = position1.j + viewport.bottom - 0.5f;
+    float x1 = position2.i + viewport.left - 0.5f, y1 = position2.j + viewport.bottom - 0.5f;
+    bool steep = fabsf(y1 - y0) > fabsf(x1 - x0);
+    if (steep)
+    {
+        std::swap(x0, y0);
+        std::swap(x1, y1);
+    }
+    if (x0 > x1)
+    {
+        std::swap(x0, x1);
+        std::swap(y0, y1);
+    }
+
+    float dx = x1 - x0;
+    float gradient = dx == 0 ? 1 : (y1 - y0) / dx;
+    int majorFirst = steep ? clip.bottom : clip.left;
+    int majorLast = (steep ? clip.top : clip.right) - 1;
+    auto plot = [&](int major, int minor, float coverage)
     {
-        SetPixel(line.point[0], colour);
-        if ((int)line.point[0].i == (int)line.point[1].i && (int)line.point[0].j == (int)line.point[1].j) break;
-        short e2 = 2 * err;
-        if (e2 >= dy)
+        if (steep)
+            BlendPixel(minor, major, colour, (int)(coverage * 255));
+        else
+            BlendPixel(major, minor, colour, (int)(coverage * 255));
+    };
+
+    //End points are weighted by how much of their pixel the segment actually spans
+    float xEnd = floorf(x0 + 0.5f);
+    float yEnd = y0 + gradient * (xEnd - x0);
+    float xGap = 1 - (x0 + 0.5f - floorf(x0 + 0.5f));
+    int xStart = (int)xEnd;
+    float yFloor = floorf(yEnd);
+    plot(xStart, (int)yFloor, (1 - (yEnd - yFloor)) * xGap);
+    plot(xStart, (int)yFloor + 1, (yEnd - yFloor) * xGap);
+    float intercept = yEnd + gradient;
+
+    xEnd = floorf(x1 + 0.5f);
+    yEnd = y1 + gradient * (xEnd - x1);
+    xGap = x1 + 0.5f - floorf(x1 + 0.5f);
+    int xStop = (int)xEnd;
+    if (xStop != xStart)
+    {
+        yFloor = floorf(yEnd);
+        plot(xStop, (int)yFloor, (1 - (yEnd - yFloor)) * xGap);
+        plot(xStop, (int)yFloor + 1, (yEnd - yFloor) * xGap);
+    }
+
+    //Only the steps inside the clip along the major axis are walked
+    int first = xStart + 1;
+    int last = xStop - 1;
+    if (first < majorFirst)
+    {
+        intercept += gradient * (majorFirst - first);
+        first = majorFirst;
+    }
+    if (last > majorLast)
+        last = majorLast;
+
+    //Steep lines cover a pair of pixels per row, shallow ones a run along each of two rows until the intercept crosses a pixel
+    if (steep)
+    {
+        for (int x = first; x <= last; x++)
         {
-            err += dy;
-            line.point[0].i += sx;
+            float interceptFloor = floorf(intercept);
+            float fraction = intercept - interceptFloor;
+            unsigned char pair[2] = { (unsigned char)((1 - fraction) * 255), (unsigned char)(fraction * 255) };
+            BlendSpan(x, (int)interceptFloor, (int)interceptFloor + 1, colour, pair);
+            intercept += gradient;
         }
-        if (e2 <= dx)
+        return;
+    }
+
+    const int runLength = 64;
+    unsigned char lower[runLength], upper[runLength];
+    int runStart = first, runCount = 0, runRow = 0;
+    for (int x = first; x <= last + 1; x++)
+    {
+        float interceptFloor = floorf(intercept);
+        if (runCount && (x > last || (int)interceptFloor != runRow || runCount == runLength))
         {
-            err += dx;
-            line.point[0].j += sy;
+            BlendSpan(runRow, runStart, runStart + runCount - 1, colour, lower);
+            BlendSpan(runRow + 1, runStart, runStart + runCount - 1, colour, upper);
+            runCount = 0;
         }
+        if (x > last)
+            break;
+        if (!runCount)
+        {
+            runStart = x;
+            runRow = (int)interceptFloor;
+        }
+
+        float fraction = intercept - interceptFloor;
+        lower[runCount] = (unsigned char)((1 - fraction) * 255);
+        upper[runCount] = (unsigned char)(fraction * 255);
+        runCount++;
+        intercept += gradient;
     }
-} 
+}
 void CGE::DrawLineEx(Vector2 position1, Vector2 position2, const Colour& colour, int thickness)
 {
+    PROFILE_ZONE("DrawLineEx");
+    COUNT_DRAW(LineEx);
+
     if (thickness < 1)
         return;
 
@@ -310,73 +1210,478 @@ void CGE::DrawLineEx(Vector2 position1, Vector2 position2, const Colour& colour,
     {
         DrawLine(position1, position2, colour);
         return;
-    }
+    }
+
+    if (colour.a == 0)
+        return;
+
+    tVector2<int> p[2];
+    p[0] = position1;
+    p[1] = position2;
+    CHAR_INFO glyph = GetCharInfo(colour);
+    const CHAR_INFO* opaque = colour.a == 255 ? &glyph : nullptr;
+
+    if (p[0].i == p[1].i)
+    {
+        int B, T, L, R, H;
+        H = thickness * 0.5f;
+        if (p[0].j < p[1].j)
+        {
+            B = p[0].j; T = p[1].j;
+        }
+        else
+        {
+        B = p[1].j; T = p[0].j;
+        }
+        L = p[0].i - H;
+        R = L + thickness;
+
+        for (int h = B; h <= T; h++)
+            ClipSpan(h + viewport.bottom, L + viewport.left, R - 1 + viewport.left, colour, opaque);
+
+        return;
+    }
+
+    if (p[0].j == p[1].j)
+    {
+        int B, T, L, R, H;
+        H = thickness * 0.5f;
+        if (p[0].i < p[1].i)
+        {
+            L = p[0].i; R = p[1].i;
+        }
+        else
+        {
+            L = p[1].i; R = p[0].i;
+        }
+        B = p[0].j - H;
+        T = B + thickness;
+
+        for (int h = B; h < T; h++)
+            ClipSpan(h + viewport.bottom, L + viewport.left, R + viewport.left, colour, opaque);
+
+        return;
+    }
+
+    //One quad filled as a single polygon, two triangles would blend their shared edge twice
+    Vector2 ends[2] = { position1, position2 };
+    Path stroke;
+    stroke.Stroke(ends, 2, (float)thickness);
+    FillPath(stroke, colour);
+}
+void CGE::DrawLineEx(Line line, const Colour& colour, int thickness)
+{
+    DrawLineEx(line.point[0], line.point[1], colour, thickness);
+}
+void CGE::DrawPolylineEx(const Vector2* points, size_t count, float thickness, const Colour& colour, Line_Join join)
+{
+    PROFILE_ZONE("DrawPolylineEx");
+    COUNT_DRAW(LineEx);
+
+    if (colour.a == 0)
+        return;
+
+    Path stroke;
+    stroke.Stroke(points, count, thickness, join);
+    FillPath(stroke, colour);
+}
+void CGE::FillSpan(int y, int x0, int x1, const Colour& colour, const CHAR_INFO* glyph)
+{
+    Colour* pixels = screenBuffer.pixelBuffer + screenSize.i * y;
+    CHAR_INFO* chars = screenBuffer.charBuffer + screenSize.i * (screenSize.j - y - 1);
+    for (int x = x0; x <= x1; x++)
+    {
+        COUNT_PIXEL(pixelsWritten);
+        COUNT_OVERDRAW(screenSize.i * y + x);
+        if (glyph)
+        {
+            pixels[x] = colour;
+            chars[x] = *glyph;
+        }
+        else
+        {
+            COUNT_PIXEL(pixelsBlended);
+            pixels[x] = colour + pixels[x];
+            chars[x] = GetCharInfo(pixels[x]);
+        }
+    }
+}
+void CGE::ClipSpan(int y, int x0, int x1, const Colour& colour, const CHAR_INFO* glyph)
+{
+    if (y < clip.bottom || y >= clip.top)
+        return;
+    if (x0 < clip.left) x0 = clip.left;
+    if (x1 > clip.right - 1) x1 = clip.right - 1;
+    if (x0 <= x1)
+        FillSpan(y, x0, x1, colour, glyph);
+}
+void CGE::FillPath(const Path& path, const Colour& colour, Fill_Rule rule)
+{
+    if (colour.a == 0 || path.contourEnds.empty())
+        return;
+
+    CHAR_INFO glyph = GetCharInfo(colour);
+    const CHAR_INFO* opaque = colour.a == 255 ? &glyph : nullptr;
+    ScanPolygon(path.points.data(), path.contourEnds.data(), (int)path.contourEnds.size(), rule,
+        [&](int y, int x0, int x1) { FillSpan(y, x0, x1, colour, opaque); }, Vector2((float)viewport.left, (float)viewport.bottom));
+}
+void CGE::ScanEdge(const Vector2& a, const Vector2& b, bool right)
+{
+    //Rows whose pixel centre lies in [bottom, top) of the edge, the same rule ScanPolygon uses
+    const Vector2& bottom = a.j < b.j ? a : b;
+    const Vector2& top = a.j < b.j ? b : a;
+    int firstRow = (int)ceilf(bottom.j - 0.5f);
+    int lastRow = (int)ceilf(top.j - 0.5f) - 1;
+    if (firstRow < clip.bottom) firstRow = clip.bottom;
+    if (lastRow > clip.top - 1) lastRow = clip.top - 1;
+
+    float slope = (top.i - bottom.i) / (top.j - bottom.j);
+    int* slot = screenBuffer.edgeBuffer + (right ? 1 : 0);
+    for (int y = firstRow; y <= lastRow; y++)
+    {
+        float x = bottom.i + (y + 0.5f - bottom.j) * slope;
+        slot[y * 2] = right ? (int)ceilf(x - 0.5f) - 1 : (int)ceilf(x - 0.5f);
+    }
+}
+void CGE::ScanEdgeBuffer(float bottom, float top, const std::function<void(int, int, int)>& span)
+{
+    int firstRow = (int)ceilf(bottom - 0.5f);
+    int lastRow = (int)ceilf(top - 0.5f) - 1;
+    if (firstRow < clip.bottom) firstRow = clip.bottom;
+    if (lastRow > clip.top - 1) lastRow = clip.top - 1;
+
+    for (int y = firstRow; y <= lastRow; y++)
+    {
+        int x0 = screenBuffer.edgeBuffer[y * 2];
+        int x1 = screenBuffer.edgeBuffer[y * 2 + 1];
+        if (x0 < clip.left) x0 = clip.left;
+        if (x1 > clip.right - 1) x1 = clip.right - 1;
+        if (x0 <= x1)
+            span(y, x0, x1);
+    }
+}
+void CGE::ScanPolygon(const Vector2* points, const int* contourEnds, int contourCount, Fill_Rule rule, const std::function<void(int, int, int)>& span, const Vector2& offset)
+{
+    struct Edge
+    {
+        int firstRow;
+        int lastRow;
+        float x;
+        float bottomX;
+        float bottomY;
+        float slope;
+        int direction;
+    };
+
+    //Edge table sorted by first row, already clipped to the clip rows. offset moves the points into screen space
+    std::vector<Edge> edges;
+    int start = 0;
+    for (int c = 0; c < contourCount; c++)
+    {
+        int end = contourEnds[c];
+        for (int i = start, j = end - 1; i < end; j = i++)
+        {
+            Vector2 a = points[j] + offset;
+            Vector2 b = points[i] + offset;
+            if (a.j == b.j)
+                continue;
+
+            const Vector2& bottom = a.j < b.j ? a : b;
+            const Vector2& top = a.j < b.j ? b : a;
+            Edge edge;
+            edge.firstRow = (int)ceilf(bottom.j - 0.5f);
+            edge.lastRow = (int)ceilf(top.j - 0.5f) - 1;
+            if (edge.firstRow < clip.bottom) edge.firstRow = clip.bottom;
+            if (edge.lastRow > clip.top - 1) edge.lastRow = clip.top - 1;
+            if (edge.firstRow > edge.lastRow)
+                continue;
+
+            edge.slope = (top.i - bottom.i) / (top.j - bottom.j);
+            edge.bottomX = bottom.i;
+            edge.bottomY = bottom.j;
+            edge.direction = b.j > a.j ? 1 : -1;
+            edges.push_back(edge);
+        }
+        start = end;
+    }
+    if (edges.empty())
+        return;
+
+    std::sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) { return a.firstRow < b.firstRow; });
+
+    std::vector<Edge> active;
+    size_t next = 0;
+    for (int y = edges[0].firstRow; next < edges.size() || !active.empty(); y++)
+    {
+        for (size_t i = 0; i < active.size();)
+        {
+            if (active[i].lastRow < y)
+            {
+                active[i] = active.back();
+                active.pop_back();
+            }
+            else
+                i++;
+        }
+        while (next < edges.size() && edges[next].firstRow == y)
+            active.push_back(edges[next++]);
+
+        //Crossings are evaluated from the bottom point like ScanEdge, so convex and general fills agree to the pixel
+        for (Edge& edge : active)
+            edge.x = edge.bottomX + (y + 0.5f - edge.bottomY) * edge.slope;
+
+        //Crossings barely move between rows, insertion sort is close to linear
+        for (size_t i = 1; i < active.size(); i++)
+        {
+            Edge edge = active[i];
+            size_t j = i;
+            for (; j > 0 && active[j - 1].x > edge.x; j--)
+                active[j] = active[j - 1];
+            active[j] = edge;
+        }
+
+        //Neighbouring spans are merged so every covered pixel is written once
+        int winding = 0;
+        float spanStart = 0;
+        for (const Edge& edge : active)
+        {
+            bool wasInside = rule == Fill_EvenOdd ? (winding & 1) != 0 : winding != 0;
+            winding += rule == Fill_EvenOdd ? 1 : edge.direction;
+            bool inside = rule == Fill_EvenOdd ? (winding & 1) != 0 : winding != 0;
+
+            if (!wasInside && inside)
+                spanStart = edge.x;
+            else if (wasInside && !inside)
+            {
+                int x0 = (int)ceilf(spanStart - 0.5f);
+                int x1 = (int)ceilf(edge.x - 0.5f) - 1;
+                if (x0 < clip.left) x0 = clip.left;
+                if (x1 > clip.right - 1) x1 = clip.right - 1;
+                if (x0 <= x1)
+                    span(y, x0, x1);
+            }
+        }
+    }
+}
+int CGE::FanWeights(const Vector2* points, int count, const Vector2& centre, const Vector2& position, float& weightCentre, float& weight0, float& weight1)
+{
+    //Barycentric weights in the fan triangle from the centre that holds position, the closest one if rounding leaves it in none
+    int best = 0;
+    float bestWorst = -1e30f;
+    for (int k = 0; k < count; k++)
+    {
+        const Vector2& a = points[k];
+        const Vector2& b = points[(k + 1) % count];
+        float area = (a.i - centre.i) * (b.j - centre.j) - (a.j - centre.j) * (b.i - centre.i);
+        if (area == 0)
+            continue;
+
+        float w0 = ((b.i - position.i) * (centre.j - position.j) - (b.j - position.j) * (centre.i - position.i)) / area;
+        float w1 = ((centre.i - position.i) * (a.j - position.j) - (centre.j - position.j) * (a.i - position.i)) / area;
+        float wc = 1 - w0 - w1;
+        float worst = wc < w0 ? (wc < w1 ? wc : w1) : (w0 < w1 ? w0 : w1);
+        if (worst > bestWorst)
+        {
+            bestWorst = worst;
+            best = k;
+            weightCentre = wc;
+            weight0 = w0;
+            weight1 = w1;
+            if (worst >= 0)
+                break;
+        }
+    }
+    return best;
+}
+void CGE::ShadeSpan(const Vector2* points, const Colour* colours, int count, int y, int x0, int x1)
+{
+    Vector2 centre = { 0, 0 };
+    float r = 0, g = 0, b = 0, a = 0;
+    for (int k = 0; k < count; k++)
+    {
+        centre.i += points[k].i / count;
+        centre.j += points[k].j / count;
+        r += colours[k].r; g += colours[k].g; b += colours[k].b; a += colours[k].a;
+    }
+    r /= count; g /= count; b /= count; a /= count;
+
+    for (int x = x0; x <= x1; x++)
+    {
+        float wc, w0, w1;
+        int k = FanWeights(points, count, centre, { x + 0.5f, y + 0.5f }, wc, w0, w1);
+        const Colour& c0 = colours[k];
+        const Colour& c1 = colours[(k + 1) % count];
+        Colour colour(
+            (int)(r * wc + c0.r * w0 + c1.r * w1 + 0.5f),
+            (int)(g * wc + c0.g * w0 + c1.g * w1 + 0.5f),
+            (int)(b * wc + c0.b * w0 + c1.b * w1 + 0.5f),
+            (int)(a * wc + c0.a * w0 + c1.a * w1 + 0.5f));
+        if (colour.a)
+            WritePixel(x, y, colour);
+    }
+}
+void CGE::TextureSpan(const Vector2* points, const Vector2* texels, int count, const Texture& texture, int y, int x0, int x1)
+{
+    Vector2 centre = { 0, 0 };
+    Vector2 texelCentre = { 0, 0 };
+    for (int k = 0; k < count; k++)
+    {
+        centre.i += points[k].i / count;
+        centre.j += points[k].j / count;
+        texelCentre.i += texels[k].i / count;
+        texelCentre.j += texels[k].j / count;
+    }
+
+    for (int x = x0; x <= x1; x++)
+    {
+        float wc, w0, w1;
+        int k = FanWeights(points, count, centre, { x + 0.5f, y + 0.5f }, wc, w0, w1);
+        const Vector2& t0 = texels[k];
+        const Vector2& t1 = texels[(k + 1) % count];
+        int u = (int)floorf(texelCentre.i * wc + t0.i * w0 + t1.i * w1);
+        int v = (int)floorf(texelCentre.j * wc + t0.j * w0 + t1.j * w1);
+        if (u < 0) u = 0;
+        if (u > texture.textureWidth - 1) u = texture.textureWidth - 1;
+        if (v < 0) v = 0;
+        if (v > texture.textureHeight - 1) v = texture.textureHeight - 1;
+
+        const Colour& colour = texture.data[texture.textureWidth * v + u];
+        if (colour.a)
+            WritePixel(x, y, colour);
+    }
+}
+void CGE::DrawText(const std::string& text, const tVector2<int>& position, const Colour& colour, int scale)
+{
+    PROFILE_ZONE("DrawText");
+
+    if (colour.a == 0 || scale < 1)
+        return;
 
-    tVector2<int> p[2];
-    p[0] = position1;
-    p[1] = position2;
+    //position is the top left of the first glyph, rows are written downwards
+    int advance = (font.glyphWidth + 1) * scale;
+    int lineHeight = (font.glyphHeight + 1) * scale;
+    tVector2<int> start(position.i + viewport.left, position.j + viewport.bottom);
+    tVector2<int> cursor = start;
+    CHAR_INFO fill = GetCharInfo(colour);
+    const CHAR_INFO* opaque = colour.a == 255 ? &fill : nullptr;
 
-    if (p[0].i == p[1].i)
+    for (char character : text)
     {
-        int B, T, L, R, H;
-        H = thickness * 0.5f;
-        if (p[0].j < p[1].j)
+        if (character == '\n')
         {
-            B = p[0].j; T = p[1].j;
+            cursor.i = start.i;
+            cursor.j -= lineHeight;
+            continue;
         }
-        else
+
+        //Skip glyphs outside clip, retained frames usually redraw a small part of the text
+        if (cursor.i >= clip.right || cursor.i + advance <= clip.left || cursor.j < clip.bottom || cursor.j - lineHeight >= clip.top)
         {
-        B = p[1].j; T = p[0].j;
+            cursor.i += advance;
+            continue;
         }
-        L = p[0].i - H;
-        R = L + thickness;
 
-        for (int h = B; h <= T; h++)
+        const unsigned char* glyph = font.GetGlyph(character);
+        for (int y = 0; y < font.glyphHeight; y++)
         {
-            for (int w = L; w < R; w++)
-                SetPixel({ w, h }, colour);
+            unsigned char row = glyph[y];
+            for (int x = 0; row; x++, row >>= 1)
+            {
+                if (!(row & 1))
+                    continue;
+
+                int L = cursor.i + x * scale;
+                int U = cursor.j - y * scale;
+                for (int h = U; h > U - scale; h--)
+                    ClipSpan(h, L, L + scale - 1, colour, opaque);
+            }
         }
 
-        return;
+        cursor.i += advance;
     }
+}
+void CGE::DrawTextNative(const std::string& text, const tVector2<int>& position, const Colour& colour, const Colour& background)
+{
+    PROFILE_ZONE("DrawText");
 
-    if (p[0].j == p[1].j)
+    //One character per console cell, written straight to charBuffer so pixelBuffer is left untouched
+    WORD attributes = colourMap.GetConsoleColour(colour) | (colourMap.GetConsoleColour(background) << 4);
+    tVector2<int> cursor(position.i + viewport.left, position.j + viewport.bottom);
+
+    for (char character : text)
     {
-        int B, T, L, R, H;
-        H = thickness * 0.5f;
-        if (p[0].i < p[1].i)
-        {
-            L = p[0].i; R = p[1].i;
-        }
-        else
+        if (character == '\n')
         {
-            L = p[1].i; R = p[0].i;
+            cursor.i = position.i + viewport.left;
+            cursor.j--;
+            continue;
         }
-        B = p[0].j - H;
-        T = B + thickness;
 
-        for (int h = B; h < T; h++)
+        if (cursor.i >= clip.left && cursor.i < clip.right && cursor.j >= clip.bottom && cursor.j < clip.top)
         {
-            for (int w = L; w <= R; w++)
-                SetPixel({ w, h }, colour);
+            CHAR_INFO& cell = screenBuffer.charBuffer[screenSize.i * (screenSize.j - cursor.j - 1) + cursor.i];
+            cell.Char.UnicodeChar = (unsigned char)character;
+            cell.Attributes = attributes;
         }
+        cursor.i++;
+    }
+}
 
-        return;
+void CGE::DrawHud()
+{
+    SetRenderTarget(nullptr);
+    Frame_Stats stats = frameStats.Read();
+
+    std::string text;
+    char line[64];
+    sprintf_s(line, "FPS %.0f  %.2fms\n", stats.fps, stats.frameTime);
+    text += line;
+    sprintf_s(line, "P50 %.2f P95 %.2f P99 %.2f\n", stats.p50, stats.p95, stats.p99);
+    text += line;
+    for (int i = 0; i < stats.stageCount; i++)
+    {
+        sprintf_s(line, "%-12.12s %6.3f %6.3f\n", stats.stages[i].name, stats.stages[i].p50, stats.stages[i].p99);
+        text += line;
+    }
+    if (recorder)
+    {
+        sprintf_s(line, "REC %lld %.0fB/f %.3fms\n", recorder->framesRecorded, recorder->BytesPerFrame(),
+            recorder->framesRecorded ? recorder->encodeTime * 1000 / recorder->framesRecorded : 0.0);
+        text += line;
+    }
+    if (terminal)
+    {
+        sprintf_s(line, "VT %.0fB/f %.3fms\n", terminal->BytesPerFrame(),
+            terminal->framesPresented ? terminal->encodeTime * 1000 / terminal->framesPresented : 0.0);
+        text += line;
     }
 
-    Vector2 P = (position2 - position1).Normalise() * (0.5f * thickness);
-    Vector2 tP = { -P.j, P.i };
-    Vector2 TL = position1 + tP;
-    Vector2 TR = position2 + tP;
-    Vector2 BL = position1 - tP;
-    Vector2 BR = position2 - tP;
+    //The HUD always covers the whole screen, whatever viewport the game left behind
+    Clip_Rect gameViewport = viewport, gameClip = clip;
+    std::vector<Clip_Rect> gameStack;
+    gameStack.swap(clipStack);
+    ResetViewport();
 
-    DrawTriangle(TL, TR, BR, colour);
-    DrawTriangle(TL, BR, BL, colour);
-}
-void CGE::DrawLineEx(Line line, const Colour& colour, int thickness)
-{
-    DrawLineEx(line.point[0], line.point[1], colour, thickness);
+    //Native text writes charBuffer, which sub-cell modes don't present
+    bool native = hudNative && !cellBuffer;
+    if (native)
+        DrawTextNative(text, { 0, screenSize.j - 1 }, WHITE, BLACK);
+    else
+        DrawText(text, { 1, screenSize.j - 2 }, WHITE);
+
+    //Retained frames keep what the HUD drew, so the game redraws the band under it next frame
+    if (retainedMode)
+    {
+        int lines = 0;
+        for (char character : text)
+            lines += character == '\n';
+        int height = native ? lines + 1 : (lines + 1) * (font.glyphHeight + 1) + 2;
+        Invalidate(0, screenSize.j - height, screenSize.i, height);
+    }
+
+    viewport = gameViewport;
+    clip = gameClip;
+    clipStack.swap(gameStack);
 }
 
 void CGE::DrawEdge(Edge2D edge)
@@ -390,263 +1695,375 @@ void CGE::DrawEdgeEx(Edge2D edge, int thickness)
 
 void CGE::DrawCircle(const Vector2& position, float radius, const Colour& colour)
 {
-    int x = 0, y = radius;
-    radius = radius * radius + 1;
-
-    SetPixel({ (int)(position.i), (int)(position.j + y) }, colour);
-    SetPixel({ (int)(position.i + y), (int)(position.j) }, colour);
-    SetPixel({ (int)(position.i), (int)(position.j - y) }, colour);
-    SetPixel({ (int)(position.i - y), (int)(position.j) }, colour);
+    PROFILE_ZONE("DrawCircle");
+    COUNT_DRAW(Circle);
 
-    while (true)
-    {
-        x++; if (x * x + y * y > radius) y--;
+    int r = (int)radius;
+    if (colour.a == 0 || r < 0)
+        return;
 
-        SetPixel({ (int)(position.i + x), (int)(position.j + y) }, colour);
-        SetPixel({ (int)(position.i - x), (int)(position.j - y) }, colour);
-        SetPixel({ (int)(position.i - x), (int)(position.j + y) }, colour);
-        SetPixel({ (int)(position.i + x), (int)(position.j - y) }, colour);
+    int cx = (int)position.i + viewport.left, cy = (int)position.j + viewport.bottom;
+    if (cx + r < clip.left || cx - r >= clip.right || cy + r < clip.bottom || cy - r >= clip.top)
+        return;
 
-        if (x > y) break;
+    CHAR_INFO glyph = GetCharInfo(colour);
+    const CHAR_INFO* opaque = colour.a == 255 ? &glyph : nullptr;
 
-        SetPixel({ (int)(position.i + y), (int)(position.j + x) }, colour);
-        SetPixel({ (int)(position.i - y), (int)(position.j - x) }, colour);
-        SetPixel({ (int)(position.i - y), (int)(position.j + x) }, colour);
-        SetPixel({ (int)(position.i + y), (int)(position.j - x) }, colour);
+    //Midpoint rule, a pixel is inside when x^2 + y^2 <= r^2 + r. The half width only shrinks going up,
+    //so it is walked down with integer compares and each row is mirrored below the centre
+    int threshold = r * r + r;
+    int x = r;
+    for (int y = 0; y <= r; y++)
+    {
+        while (x * x + y * y > threshold)
+            x--;
+        ClipSpan(cy + y, cx - x, cx + x, colour, opaque);
+        if (y)
+            ClipSpan(cy - y, cx - x, cx + x, colour, opaque);
     }
 }
 void CGE::DrawCircle(const Circle& circle, const Colour& colour)
 {
     DrawCircle(circle.position, circle.radius, colour);
 }
-void CGE::DrawCircleLine(const Vector2& position, float radius, const Colour& colour, int thickness)
+void CGE::DrawCircleAA(const Vector2& position, float radius, const Colour& colour)
 {
-    //Early out code
-    //Needs work
+    PROFILE_ZONE("DrawCircleAA");
+    COUNT_DRAW(CircleLine);
 
-    int D, U;
-    int L, R;
+    if (colour.a == 0 || radius <= 0)
+        return;
 
-    D = 0;
-    U = radius - 0.5f * thickness;
+    int cx = (int)position.i + viewport.left, cy = (int)position.j + viewport.bottom;
+    int reach = (int)radius + 2;
+    if (cx + reach < clip.left || cx - reach >= clip.right || cy + reach < clip.bottom || cy - reach >= clip.top)
+        return;
 
-    for (D; D < U; D++)
+    //Wu's circle, the first octant gives a pair of pixels per column straddling the exact edge, mirrored into the other seven.
+    //Columns sharing an inner row are blended as one run across the top and bottom, the steep octants are a pair per row.
+    //The axis columns are only mirrored four ways so translucent circles do not blend them twice
+    const int runLength = 64;
+    unsigned char innerRun[runLength], outerRun[runLength], innerMirror[runLength], outerMirror[runLength];
+    int runStart = 0, runCount = 0, runInner = 0;
+    auto flushRun = [&]()
     {
-        L = sqrtf((radius - 0.5f * thickness) * (radius - 0.5f * thickness) - D * D);
-        R = sqrtf((radius + 0.5f * thickness) * (radius + 0.5f * thickness) - D * D);
+        int runEnd = runStart + runCount - 1;
+        for (int sign = 1; sign >= -1; sign -= 2)
+        {
+            BlendSpan(cy + runInner * sign, cx + runStart, cx + runEnd, colour, innerRun);
+            BlendSpan(cy + (runInner + 1) * sign, cx + runStart, cx + runEnd, colour, outerRun);
+        }
 
-        for (L; L <= R; L++)
+        //Mirrored runs read right to left, and leave out column 0
+        for (int i = 0; i < runCount; i++)
         {
-            SetPixel({ (int)(position.i + L), (int)(position.j + D) }, colour);
-            SetPixel({ (int)(position.i + L), (int)(position.j - D) }, colour);
-            SetPixel({ (int)(position.i - L), (int)(position.j + D) }, colour);
-            SetPixel({ (int)(position.i - L), (int)(position.j - D) }, colour);
+            innerMirror[i] = innerRun[runCount - 1 - i];
+            outerMirror[i] = outerRun[runCount - 1 - i];
+        }
+        int mirrorEnd = max(runStart, 1);
+        if (mirrorEnd <= runEnd)
+        {
+            for (int sign = 1; sign >= -1; sign -= 2)
+            {
+                BlendSpan(cy + runInner * sign, cx - runEnd, cx - mirrorEnd, colour, innerMirror);
+                BlendSpan(cy + (runInner + 1) * sign, cx - runEnd, cx - mirrorEnd, colour, outerMirror);
+            }
+        }
+        runCount = 0;
+    };
+
+    float radiusSquared = radius * radius;
+    //Small circles reach x > radius before y < x, where the square root would be of a negative
+    for (int x = 0; x <= radius * 0.70710678f + 1 && x <= radius; x++)
+    {
+        float y = sqrtf(radiusSquared - x * x);
+        if (y < x)
+            break;
+        int inner = (int)y;
+        int outer = inner + 1;
+        int coverage = (int)((y - inner) * 255);
+
+        if (runCount && (inner != runInner || runCount == runLength))
+            flushRun();
+        if (!runCount)
+        {
+            runStart = x;
+            runInner = inner;
+        }
+        innerRun[runCount] = (unsigned char)(255 - coverage);
+        outerRun[runCount] = (unsigned char)coverage;
+        runCount++;
+
+        //On the diagonal the steep octant lands on a pixel the run already covers
+        unsigned char right[2] = { (unsigned char)(255 - coverage), (unsigned char)coverage };
+        unsigned char left[2] = { (unsigned char)coverage, (unsigned char)(255 - coverage) };
+        int rightFirst = inner == x ? 1 : 0, rightLast = outer == x ? 0 : 1;
+        int leftFirst = outer == x ? 1 : 0, leftLast = inner == x ? 0 : 1;
+        for (int sign = 1; sign >= -1; sign -= 2)
+        {
+            if (sign < 0 && x == 0)
+                break;
+            BlendSpan(cy + x * sign, cx + inner + rightFirst, cx + inner + rightLast, colour, right + rightFirst);
+            BlendSpan(cy + x * sign, cx - outer + leftFirst, cx - outer + leftLast, colour, left + leftFirst);
         }
     }
+    if (runCount)
+        flushRun();
+}
+void CGE::DrawCircleLine(const Vector2& position, float radius, const Colour& colour, int thickness)
+{
+    PROFILE_ZONE("DrawCircleLine");
+    COUNT_DRAW(CircleLine);
+
+    int outer = (int)(radius + thickness * 0.5f);
+    int inner = outer - thickness;
+    if (colour.a == 0 || thickness < 1 || outer < 0)
+        return;
+
+    int cx = (int)position.i + viewport.left, cy = (int)position.j + viewport.bottom;
+    if (cx + outer < clip.left || cx - outer >= clip.right || cy + outer < clip.bottom || cy - outer >= clip.top)
+        return;
 
-    U = radius + 0.5f * thickness;
+    CHAR_INFO glyph = GetCharInfo(colour);
+    const CHAR_INFO* opaque = colour.a == 255 ? &glyph : nullptr;
 
-    for (D; D <= U; D++)
+    //Same midpoint rule as DrawCircle for both edges, rows that cross the hole get a span either side of it
+    int outerThreshold = outer * outer + outer;
+    int innerThreshold = inner * inner + inner;
+    int xo = outer, xi = inner;
+    for (int y = 0; y <= outer; y++)
     {
-        L = 0;
-        R = sqrtf((radius + 0.5f * thickness) * (radius + 0.5f * thickness) - D * D);
+        while (xo * xo + y * y > outerThreshold)
+            xo--;
 
-        for (L; L <= R; L++)
+        int rows[2] = { cy + y, cy - y };
+        for (int k = 0; k < (y ? 2 : 1); k++)
         {
-            SetPixel({ (int)(position.i + L), (int)(position.j + D) }, colour);
-            SetPixel({ (int)(position.i + L), (int)(position.j - D) }, colour);
-            SetPixel({ (int)(position.i - L), (int)(position.j + D) }, colour);
-            SetPixel({ (int)(position.i - L), (int)(position.j - D) }, colour);
+            if (y > inner || inner < 0)
+                ClipSpan(rows[k], cx - xo, cx + xo, colour, opaque);
+            else
+            {
+                ClipSpan(rows[k], cx - xo, cx - xi - 1, colour, opaque);
+                ClipSpan(rows[k], cx + xi + 1, cx + xo, colour, opaque);
+            }
         }
-    }
 
-    
+        if (y <= inner)
+            while (xi >= 0 && xi * xi + (y + 1) * (y + 1) > innerThreshold)
+                xi--;
+    }
 }
 void CGE::DrawCircleLine(const Circle& circle, const Colour& colour, int thickness)
 {
     DrawCircleLine(circle.position, circle.radius, colour, thickness);
 }
 
+//Implicit form u x^2 + v y^2 + w x y <= 1 of an ellipse with semi axes a and b, turned the same way as the old DrawOvalLine
+struct Ellipse_Form
+{
+    float u, v, w;
+};
+static Ellipse_Form MakeEllipse(float a, float b, float rotation)
+{
+    float c = cosf(rotation);
+    float s = sinf(-rotation);
+    float at = 1.0f / (a * a);
+    float bt = 1.0f / (b * b);
+    return { c * c * at + s * s * bt, s * s * at + c * c * bt, 2.0f * c * s * (at - bt) };
+}
+//Pixel offsets inside the ellipse on row y, the same row at -y is the point reflection
+static bool EllipseRow(const Ellipse_Form& e, int y, int& left, int& right, bool keepNearest)
+{
+    float discriminant = e.w * e.w * y * y - 4 * e.u * (e.v * y * y - 1);
+    if (discriminant < 0)
+        return false;
+    float root = sqrtf(discriminant);
+    left = (int)ceilf((-e.w * y - root) / (2 * e.u));
+    right = (int)floorf((-e.w * y + root) / (2 * e.u));
+
+    //A thin ellipse can cross the row between two pixel centres, keep the nearest one so the shape stays in one piece
+    if (left > right && keepNearest)
+        left = right = (int)floorf(-e.w * y / (2 * e.u) + 0.5f);
+    return left <= right;
+}
+//Stretches the spans of consecutive rows until they touch, steep rows can jump sideways further than the shape is wide.
+//Each row holds pieces spans of { left, right }, empty pieces have left > right
+static void ConnectRows(std::vector<int>& spans, int rowCount, int pieces)
+{
+    int stride = pieces * 2;
+    for (int y = 0; y + 1 < rowCount; y++)
+    {
+        for (int k = 0; k < stride; k += 2)
+        {
+            int* a = &spans[y * stride + k];
+            int* b = &spans[(y + 1) * stride + k];
+            if (a[0] > a[1] || b[0] > b[1])
+                continue;
+            if (b[0] > a[1] + 1)
+                b[0] = a[1] + 1;
+            if (a[0] > b[1] + 1)
+                a[0] = b[1] + 1;
+            if (b[1] < a[0] - 1)
+                b[1] = a[0] - 1;
+            if (a[1] < b[0] - 1)
+                a[1] = b[0] - 1;
+        }
+    }
+}
+static int EllipseHeight(const Ellipse_Form& e)
+{
+    return (int)sqrtf(4 * e.u / (4 * e.u * e.v - e.w * e.w));
+}
+
 void CGE::DrawOval(const Vector2& position, const Vector2& size, float rotation, const Colour& colour)
 {
-    
+    PROFILE_ZONE("DrawOval");
+    COUNT_DRAW(Oval);
+
+    if (colour.a == 0 || size.i < 0 || size.j < 0)
+        return;
+
+    int cx = (int)position.i + viewport.left, cy = (int)position.j + viewport.bottom;
+    Ellipse_Form ellipse = MakeEllipse(size.i + 0.5f, size.j + 0.5f, rotation);
+    int height = EllipseHeight(ellipse);
+    if (cy + height < clip.bottom || cy - height >= clip.top)
+        return;
+
+    //One square root per row pair, the row below the centre is the reflection of the one above
+    int rowCount = height * 2 + 1;
+    std::vector<int> spans(rowCount * 2);
+    for (int y = 0; y <= height; y++)
+    {
+        int* row = &spans[(height + y) * 2];
+        if (!EllipseRow(ellipse, y, row[0], row[1], true))
+        {
+            row[0] = 1;
+            row[1] = 0;
+        }
+        if (!y)
+            continue;
+        int* mirror = &spans[(height - y) * 2];
+        mirror[0] = -row[1];
+        mirror[1] = -row[0];
+    }
+    ConnectRows(spans, rowCount, 1);
+
+    CHAR_INFO glyph = GetCharInfo(colour);
+    const CHAR_INFO* opaque = colour.a == 255 ? &glyph : nullptr;
+    for (int y = 0; y < rowCount; y++)
+        if (spans[y * 2] <= spans[y * 2 + 1])
+            ClipSpan(cy - height + y, cx + spans[y * 2], cx + spans[y * 2 + 1], colour, opaque);
 }
 void CGE::DrawOval(const Oval& oval, float rotation, const Colour& colour)
 {
-
+    DrawOval(oval.position, oval.size, rotation, colour);
 }
 void CGE::DrawOvalLine(const Vector2& position, const Vector2& size, float rotation, const Colour& colour, int thickness)
 {
-    if (!rotation)
+    PROFILE_ZONE("DrawOvalLine");
+    COUNT_DRAW(OvalLine);
+
+    if (colour.a == 0 || thickness < 1 || size.i < 0 || size.j < 0)
+        return;
+
+    int cx = (int)position.i + viewport.left, cy = (int)position.j + viewport.bottom;
+    float half = thickness * 0.5f;
+    Ellipse_Form outer = MakeEllipse(size.i + half, size.j + half, rotation);
+    bool hole = size.i > half && size.j > half;
+    Ellipse_Form inner = hole ? MakeEllipse(size.i - half, size.j - half, rotation) : outer;
+    int height = EllipseHeight(outer);
+    if (cy + height < clip.bottom || cy - height >= clip.top)
+        return;
+
+    //Each row has a left and right piece of the ring, or one span above and below the hole
+    int rowCount = height * 2 + 1;
+    std::vector<int> spans(rowCount * 4);
+    for (int y = 0; y <= height; y++)
     {
-        if (thickness == 1)
+        int ol, orr, il, ir;
+        int* row = &spans[(height + y) * 4];
+        if (!EllipseRow(outer, y, ol, orr, true))
         {
-
+            row[0] = row[2] = 1;
+            row[1] = row[3] = 0;
+        }
+        else if (!hole || !EllipseRow(inner, y, il, ir, false))
+        {
+            //Both pieces cover the whole row so either side can reach the next one, they merge when written
+            row[0] = row[2] = ol;
+            row[1] = row[3] = orr;
         }
         else
         {
-
+            //Never let a side vanish where the ring is thinner than a pixel
+            row[0] = ol; row[1] = il - 1 < ol ? ol : il - 1;
+            row[2] = ir + 1 > orr ? orr : ir + 1; row[3] = orr;
         }
+
+        if (!y)
+            continue;
+        int* mirror = &spans[(height - y) * 4];
+        mirror[0] = -row[3]; mirror[1] = -row[2];
+        mirror[2] = -row[1]; mirror[3] = -row[0];
     }
-    else
+
+    //Close the ring where the hole reaches the first and last rows
+    for (int y = 0; y < rowCount; y += rowCount - 1)
     {
-        if (thickness == 1)
+        int* row = &spans[y * 4];
+        if (row[0] <= row[1] && row[2] <= row[3])
         {
-            float s0 = sinf(-rotation);
-            float c0 = cosf(rotation);
-            float s2 = s0 * s0;
-            float c2 = 1.0f - s2;
-            float a = size.i;
-            float b = size.j;
-            float a2 = size.i * size.i;
-            float b2 = size.j * size.j;
-            float at = 1.0f / a2;
-            float bt = 1.0f / b2;
-            float u = c2 * at + s2 * bt;
-            float v = s2 * at + c2 * bt;
-            float w = 2.0f * c0 * s0 * (at - bt);
-            float s = -(2.0f * u + w) / (2.0f * v + w);
-            float t = (2.0f * u - w) / (2.0f * v - w);
-
-            Vector2 L;
-            L.i = -sqrtf(v) * a * b;
-            L.j = -w * L.i * 0.5f / v;
-
-            Vector2 R = L * -1;
-
-            Vector2 U;
-            U.j = sqrtf(u) * a * b;
-            U.i = -w * L.j * 0.5f / u + 1;
-
-            Vector2 incline;
-            incline.i = -1.0f / sqrtf(u + v * s * s + w * s);
-            incline.j = s * incline.i;
-
-            incline.i = incline.i;
-            incline.j = incline.j;
-
-            Vector2 decline;
-            decline.i = 1.0f / sqrtf(u + v * t * t + w * t);
-            decline.j = t * decline.i;
-
-            decline.i = decline.i;
-            decline.j = decline.j;
-
-            float x1 = L.i + 1;
-            float y1 = L.j;
-
-            float x2 = R.i;
-            float y2 = R.j;
-
-            SetPixel({ (int)(x1 + position.i), (int)(y1 + position.j) }, colour);
-            SetPixel({ (int)(-x1 + position.i), (int)(-y1 + position.j) }, colour);
-            SetPixel({ (int)(x2 + position.i), (int)(y2 + position.j) }, colour);
-            SetPixel({ (int)(-x2 + position.i), (int)(-y2 + position.j) }, colour);
-            SetPixel({ (int)(U.i + position.i), (int)(U.j + 1 + position.j) }, colour);
-            SetPixel({ (int)(-U.i + position.i), (int)(-U.j - 1 + position.j) }, colour);
-
-            while (y1 < incline.j)
-            {
-                SetPixel({ (int)(x1 + position.i), (int)(y1 + position.j) }, colour);
-                SetPixel({ (int)(-x1 + position.i), (int)(-y1 + position.j) }, colour);
-                y1++;
-                if (u * x1 * x1 + v * y1 * y1 + w * x1 * y1 > 1) x1++;
-            }
-            while (y2 < decline.j)
-            {
-                SetPixel({ (int)(x2 + position.i), (int)(y2 + position.j) }, colour);
-                SetPixel({ (int)(-x2 + position.i), (int)(-y2 + position.j) }, colour);
-                y2++;
-                if (u * x2 * x2 + v * y2 * y2 + w * x2 * y2 > 1) x2--;
-            }
-            while (x1 < U.i)
-            {
-                SetPixel({ (int)(x1 + position.i), (int)(y1 + position.j) }, colour);
-                SetPixel({ (int)(-x1 + position.i), (int)(-y1 + position.j) }, colour);
-                x1++;
-                if (u * (x1) * (x1)+v * (y1 - 1) * (y1 - 1) + w * (x1) * (y1 - 1) < 1) y1++;
-            }
-            while (x2 > U.i)
-            {
-                SetPixel({ (int)(x2 + position.i), (int)(y2 + position.j) }, colour);
-                SetPixel({ (int)(-x2 + position.i), (int)(-y2 + position.j) }, colour);
-                x2--;
-                if (u * x2 * x2 + v * (y2 - 1) * (y2 - 1) + w * x2 * (y2 - 1) < 1) y2++;
-            }
+            row[0] = row[2] = min(row[0], row[2]);
+            row[1] = row[3] = max(row[1], row[3]);
         }
+        if (rowCount == 1)
+            break;
+    }
+    ConnectRows(spans, rowCount, 2);
+
+    CHAR_INFO glyph = GetCharInfo(colour);
+    const CHAR_INFO* opaque = colour.a == 255 ? &glyph : nullptr;
+    for (int y = 0; y < rowCount; y++)
+    {
+        int* row = &spans[y * 4];
+        if (row[0] <= row[1] && row[2] <= row[3] && row[1] + 1 >= row[2])
+            ClipSpan(cy - height + y, cx + min(row[0], row[2]), cx + max(row[1], row[3]), colour, opaque);
         else
         {
-            float c = cosf(rotation);
-            float s = sinf(-rotation);
-            float s2 = s * s;
-            float c2 = 1.0f - s2;
-            float a1 = size.i - 0.5f * thickness;
-            float a2 = size.i + 0.5f * thickness;
-            float b1 = size.j - 0.5f * thickness;
-            float b2 = size.j + 0.5f * thickness;
-            float a12 = a1 * a1;
-            float a22 = a2 * a2;
-            float b12 = b1 * b1;
-            float b22 = b2 * b2;
-            float a1t = 1.0f / a12;
-            float a2t = 1.0f / a22;
-            float b1t = 1.0f / b12;
-            float b2t = 1.0f / b22;
-            float u1 = c2 * a1t + s2 * b1t;
-            float u2 = c2 * a2t + s2 * b2t;
-            float v1 = s2 * a1t + c2 * b1t;
-            float v2 = s2 * a2t + c2 * b2t;
-            float w1 = 2.0f * c * s * (a1t - b1t);
-            float w2 = 2.0f * c * s * (a2t - b2t);
-
-            float U1 = a1 * b1 * sqrtf(u1);
-            float U2 = a2 * b2 * sqrtf(u2);
-
-            float k1 = -w1 / u1 * 0.5f;
-            float k2 = -w2 / u2 * 0.5f;
-
-            float l1 = 1.0f / (a1 * b1 * u1);
-            float l2 = 1.0f / (a2 * b2 * u2);
-
-            float m1 = b12 * c2 + a12 * s2;
-            float m2 = b22 * c2 + a22 * s2;
-
-            float L, R;
-
-            //SetPixel({ (int)position.i, (int)(U1 + position.j) }, RED);
-            //SetPixel({ (int)position.i, (int)(U2 + position.j) }, RED);
-
-            for (float h = U1; h < U2; h++)
-            {
-                L = k1 * h - a2 * b2 * sqrtf(m2 - h * h) / m2;
-                R = k1 * h + a2 * b2 * sqrtf(m2 - h * h) / m2;
-                for (L; L < (int)R + 1; L++)
-                {
-                    SetPixel({ (int)(L + position.i), (int)(h + position.j) }, colour);
-                }
-            }
-
-            
+            if (row[0] <= row[1])
+                ClipSpan(cy - height + y, cx + row[0], cx + row[1], colour, opaque);
+            if (row[2] <= row[3])
+                ClipSpan(cy - height + y, cx + row[2], cx + row[3], colour, opaque);
         }
     }
 }
 void CGE::DrawOvalLine(const Oval& oval, float rotation, const Colour& colour, int thickness)
 {
-
+    DrawOvalLine(oval.position, oval.size, rotation, colour, thickness);
 }
 
 void CGE::DrawRect(const Vector2& position, const Vector2& size, float rotation, const Colour& colour)
 {
+    PROFILE_ZONE("DrawRect");
+    COUNT_DRAW(Rect);
+
     if (!rotation)
     {
+        if (colour.a == 0)
+            return;
+
         Vector2 halfSize = size * 0.5f;
-        int minX = position.i - halfSize.i, maxX = position.i + halfSize.i;
-        int minY = position.j - halfSize.j, maxY = position.j + halfSize.j;
-        (minX < 0) ? minX = 0 : minX; (maxX > screenSize.i) ? maxX = screenSize.i : maxX;
-        (minY < 0) ? minY = 0 : minY; (maxY > screenSize.j) ? maxY = screenSize.j : maxY;
+        int minX = (int)(position.i - halfSize.i) + viewport.left, maxX = (int)(position.i + halfSize.i) + viewport.left;
+        int minY = (int)(position.j - halfSize.j) + viewport.bottom, maxY = (int)(position.j + halfSize.j) + viewport.bottom;
+        (minX < clip.left) ? minX = clip.left : minX; (maxX > clip.right) ? maxX = clip.right : maxX;
+        (minY < clip.bottom) ? minY = clip.bottom : minY; (maxY > clip.top) ? maxY = clip.top : maxY;
+        if (minX >= maxX)
+            return;
 
+        CHAR_INFO glyph = GetCharInfo(colour);
+        const CHAR_INFO* opaque = colour.a == 255 ? &glyph : nullptr;
         for (int h = minY; h < maxY; h++)
-            for (int w = minX; w < maxX; w++) SetPixel({ w, h }, colour);
+            FillSpan(h, minX, maxX - 1, colour, opaque);
     }
     else
     {
@@ -668,16 +2085,26 @@ void CGE::DrawRect(const Vector2& position, const Vector2& size, float rotation,
 }
 void CGE::DrawRect(const Rect& rect, float rotation, const Colour& colour)
 {
+    PROFILE_ZONE("DrawRect");
+    COUNT_DRAW(Rect);
+
     if (!rotation)
     {
+        if (colour.a == 0)
+            return;
+
         Vector2 halfSize = rect.size * 0.5f;
-        int minX = rect.position.i - halfSize.i, maxX = rect.position.i + halfSize.i;
-        int minY = rect.position.j - halfSize.j, maxY = rect.position.j + halfSize.j;
-        (minX < 0) ? minX = 0 : minX; (maxX > screenSize.i) ? maxX = screenSize.i : maxX;
-        (minY < 0) ? minY = 0 : minY; (maxY > screenSize.j) ? maxY = screenSize.j : maxY;
+        int minX = (int)(rect.position.i - halfSize.i) + viewport.left, maxX = (int)(rect.position.i + halfSize.i) + viewport.left;
+        int minY = (int)(rect.position.j - halfSize.j) + viewport.bottom, maxY = (int)(rect.position.j + halfSize.j) + viewport.bottom;
+        (minX < clip.left) ? minX = clip.left : minX; (maxX > clip.right) ? maxX = clip.right : maxX;
+        (minY < clip.bottom) ? minY = clip.bottom : minY; (maxY > clip.top) ? maxY = clip.top : maxY;
+        if (minX >= maxX)
+            return;
 
+        CHAR_INFO glyph = GetCharInfo(colour);
+        const CHAR_INFO* opaque = colour.a == 255 ? &glyph : nullptr;
         for (int h = minY; h < maxY; h++)
-            for (int w = minX; w < maxX; w++) SetPixel({ w, h }, colour);
+            FillSpan(h, minX, maxX - 1, colour, opaque);
     }
     else
     {
@@ -699,10 +2126,23 @@ void CGE::DrawRect(const Rect& rect, float rotation, const Colour& colour)
 }
 void CGE::DrawRectLine(const Vector2& position, const Vector2& size, float rotation, const Colour& colour, int thickness)
 {
+    PROFILE_ZONE("DrawRectLine");
+    COUNT_DRAW(RectLine);
+
     //Thickness limit early out
+    if (colour.a == 0)
+        return;
 
     if (rotation == 0)
     {
+        CHAR_INFO glyph = GetCharInfo(colour);
+        const CHAR_INFO* opaque = colour.a == 255 ? &glyph : nullptr;
+        auto band = [&](int D, int U, int L, int R)
+        {
+            for (int h = D; h <= U; h++)
+                ClipSpan(h + viewport.bottom, L + viewport.left, R + viewport.left, colour, opaque);
+        };
+
         if (thickness == 1)
         {
             int D, U, L, R;
@@ -713,15 +2153,19 @@ void CGE::DrawRectLine(const Vector2& position, const Vector2& size, float rotat
             L = position.i - H.i;
             R = position.i + H.i;
 
-            for (int h = D + 1; h < U; h++)
-            {
-                SetPixel({ L, h }, colour);
-                SetPixel({ R, h }, colour);
-            }
-            for (int w = L; w <= R; w++)
+            band(D, D, L, R);
+            if (U != D)
+                band(U, U, L, R);
+
+            //The sides are single columns, clipped once rather than per pixel
+            int first = max(D + 1 + viewport.bottom, clip.bottom), last = min(U - 1 + viewport.bottom, clip.top - 1);
+            int columns[2] = { L + viewport.left, R + viewport.left };
+            for (int k = 0; k < (R != L ? 2 : 1); k++)
             {
-                SetPixel({ w, U }, colour);
-                SetPixel({ w, D }, colour);
+                if (columns[k] < clip.left || columns[k] >= clip.right)
+                    continue;
+                for (int h = first; h <= last; h++)
+                    FillSpan(h, columns[k], columns[k], colour, opaque);
             }
         }
         else
@@ -730,27 +2174,15 @@ void CGE::DrawRectLine(const Vector2& position, const Vector2& size, float rotat
             int U = D + thickness - 1;
             int L = position.i - (size.i + thickness) * 0.5f;
             int R = position.i + (size.i + thickness) * 0.5f;
-            for (int h = D; h <= U; h++)
-            {
-                for (int w = L; w <= R; w++)
-                {
-                    SetPixel({ w, h }, colour);
-                    SetPixel({ w, h + (int)size.j }, colour);
-                }
-            }
+            band(D, U, L, R);
+            band(D + (int)size.j, U + (int)size.j, L, R);
 
             D = U + 1;
             U = D + size.j - thickness - 1;
             L = position.i - (size.i + thickness) * 0.5f;
             R = L + thickness - 1;
-            for (int h = D; h <= U; h++)
-            {
-                for (int w = L; w <= R; w++)
-                {
-                    SetPixel({ w, h }, colour);
-                    SetPixel({ w + (int)size.i + 1, h }, colour);
-                }
-            }
+            band(D, U, L, R);
+            band(D, U, L + (int)size.i + 1, R + (int)size.i + 1);
         }
     }
     else if (false) // ((int)(sin(4.0f * rotation) * 100) == 0)
@@ -906,7 +2338,10 @@ void CGE::DrawRectangleTexture(const vTriangle2D& triangle, const Texture& textu
 
 void CGE::DrawTriangle(const Vector2& p0, const Vector2& p1, const Vector2& p2, const Colour& colour)
 {
-    if (colour.r == 0 && colour.g == 0 && colour.b == 0 && colour.a == 0)
+    PROFILE_ZONE("DrawTriangle");
+    COUNT_DRAW(Triangle);
+
+    if (colour.a == 0)
         return;
 
     int A, B, M;
@@ -916,6 +2351,19 @@ void CGE::DrawTriangle(const Vector2& p0, const Vector2& p1, const Vector2& p2,
     p[1] = (Vector2)((tVector2<int>)p1);
     p[2] = (Vector2)((tVector2<int>)p2);
 
+    //Into screen space and culled against the clip once, rows are then written as clipped spans
+    for (int i = 0; i < 3; i++)
+    {
+        p[i].i += viewport.left;
+        p[i].j += viewport.bottom;
+    }
+    if (max(p[0].i, max(p[1].i, p[2].i)) < clip.left || min(p[0].i, min(p[1].i, p[2].i)) >= clip.right ||
+        max(p[0].j, max(p[1].j, p[2].j)) < clip.bottom || min(p[0].j, min(p[1].j, p[2].j)) >= clip.top)
+        return;
+
+    CHAR_INFO glyph = GetCharInfo(colour);
+    const CHAR_INFO* opaque = colour.a == 255 ? &glyph : nullptr;
+
     bool hAlligned = false;
 
     if (p[0].j == p[1].j)
@@ -969,10 +2417,7 @@ void CGE::DrawTriangle(const Vector2& p0, const Vector2& p1, const Vector2& p2,
         R = p[M].i - mB * p[M].j;
 
         for (D; D < U; D++)
-        {
-            for (int w = mA * D + L; w < (int)(mB * D + R); w++)
-                SetPixel({ w, D }, colour);
-        }
+            ClipSpan(D, (int)(mA * D + L), (int)(mB * D + R) - 1, colour, opaque);
 
         return;
     }
@@ -1004,19 +2449,13 @@ void CGE::DrawTriangle(const Vector2& p0, const Vector2& p1, const Vector2& p2,
         R = p[M].i - p[M].j * mB;
 
         for (D; D < U; D++)
-        {
-            for (int w = D * mAB + L; w < (int)(D * mB + R); w++)
-                SetPixel({ w, D }, colour);
-        }
+            ClipSpan(D, (int)(D * mAB + L), (int)(D * mB + R) - 1, colour, opaque);
 
         D = p[M].j + 0.5f; U = p[A].j + 0.5f;
         R = p[M].i - p[M].j * mA;
 
         for (D; D < U; D++)
-        {
-            for (int w = D * mAB + L; w < (int)(D * mA + R); w++)
-                SetPixel({ w, D }, colour);
-        }
+            ClipSpan(D, (int)(D * mAB + L), (int)(D * mA + R) - 1, colour, opaque);
     }
     else if (midAB.i > p[M].i)
     {
@@ -1025,24 +2464,21 @@ void CGE::DrawTriangle(const Vector2& p0, const Vector2& p1, const Vector2& p2,
         R = p[B].i - p[B].j * mAB;
 
         for (D; D < U; D++)
-        {
-            for (int w = D * mB + L; w < (int)(D * mAB + R); w++)
-                SetPixel({ w, D }, colour);
-        }
+            ClipSpan(D, (int)(D * mB + L), (int)(D * mAB + R) - 1, colour, opaque);
 
         D = p[M].j + 0.5f; U = p[A].j + 0.5f;
         L = p[M].i - p[M].j * mA;
 
         for (D; D < U; D++)
-        {
-            for (int w = D * mA + L; w < (int)(D * mAB + R); w++)
-                SetPixel({ w, D }, colour);
-        }
+            ClipSpan(D, (int)(D * mA + L), (int)(D * mAB + R) - 1, colour, opaque);
     }
 }
 void CGE::DrawTriangle(const Triangle& triangle, float rotation, const Colour& colour)
 {
-    if (colour.r == 0 && colour.g == 0 && colour.b == 0 && colour.a == 0)
+    PROFILE_ZONE("DrawTriangle");
+    COUNT_DRAW(Triangle);
+
+    if (colour.a == 0)
         return;
 
     int A, B, M;
@@ -1062,6 +2498,19 @@ void CGE::DrawTriangle(const Triangle& triangle, float rotation, const Colour& c
         p[2] = rotMat * triangle.point[2] + triangle.position;
     }
 
+    //Into screen space and culled against the clip once, rows are then written as clipped spans
+    for (int i = 0; i < 3; i++)
+    {
+        p[i].i += viewport.left;
+        p[i].j += viewport.bottom;
+    }
+    if (max(p[0].i, max(p[1].i, p[2].i)) < clip.left || min(p[0].i, min(p[1].i, p[2].i)) >= clip.right ||
+        max(p[0].j, max(p[1].j, p[2].j)) < clip.bottom || min(p[0].j, min(p[1].j, p[2].j)) >= clip.top)
+        return;
+
+    CHAR_INFO glyph = GetCharInfo(colour);
+    const CHAR_INFO* opaque = colour.a == 255 ? &glyph : nullptr;
+
     bool vAlligned = false;
     bool hAlligned = false;
 
@@ -1113,10 +2562,13 @@ void CGE::DrawTriangle(const Triangle& triangle, float rotation, const Colour& c
         U = p[M].j - mA * p[M].i;
         D = p[M].j - mB * p[M].i;
 
-        for (int w = L; w <= R; w++)
+        //Columns here, so the clip is applied to both ranges up front
+        for (int w = max(L, clip.left); w <= min(R, clip.right - 1); w++)
         {
-            for (int h = mB * w + D; h <= mA * w + U; h++)
-                SetPixel({ w, h }, colour);
+            int first = max((int)(mB * w + D), clip.bottom);
+            int last = min((int)floorf(mA * w + U), clip.top - 1);
+            for (int h = first; h <= last; h++)
+                FillSpan(h, w, w, colour, opaque);
         }
 
         return;
@@ -1171,10 +2623,7 @@ void CGE::DrawTriangle(const Triangle& triangle, float rotation, const Colour& c
         R = p[M].i - mB * p[M].j;
 
         for (int h = D; h <= U; h++)
-        {
-            for (int w = mA * h + L; w <= mB * h + R; w++)
-                SetPixel({ w, h }, colour);
-        }
+            ClipSpan(h, (int)(mA * h + L), (int)floorf(mB * h + R), colour, opaque);
 
         return;
     }
@@ -1205,19 +2654,13 @@ void CGE::DrawTriangle(const Triangle& triangle, float rotation, const Colour& c
         R = p[M].i - p[M].j * mB;
         
         for (int h = D; h < U; h++)
-        {
-            for (int w = h * mAB + L; w <= h * mB + R; w++)
-                SetPixel({ w, h }, colour);
-        }
+            ClipSpan(h, (int)(h * mAB + L), (int)floorf(h * mB + R), colour, opaque);
         
         D = p[M].j; U = p[A].j;
         R = p[M].i - p[M].j * mA;
 
         for (int h = D; h <= U; h++)
-        {
-            for (int w = h * mAB + L; w <= h * mA + R; w++)
-                SetPixel({ w, h }, colour);
-        }
+            ClipSpan(h, (int)(h * mAB + L), (int)floorf(h * mA + R), colour, opaque);
     }
     else if (midAB.i > p[M].i)
     {
@@ -1226,24 +2669,122 @@ void CGE::DrawTriangle(const Triangle& triangle, float rotation, const Colour& c
         R = p[B].i - p[B].j * mAB;
 
         for (int h = D; h < U; h++)
-        {
-            for (int w = h * mB + L; w <= h * mAB + R; w++)
-                SetPixel({ w, h }, colour);
-        }
+            ClipSpan(h, (int)(h * mB + L), (int)floorf(h * mAB + R), colour, opaque);
 
         D = p[M].j; U = p[A].j;
         L = p[M].i - p[M].j * mA;
 
         for (int h = D; h <= U; h++)
-        {
-            for (int w = h * mA + L; w <= h * mAB + R; w++)
-                SetPixel({ w, h }, colour);
-        }
+            ClipSpan(h, (int)(h * mA + L), (int)floorf(h * mAB + R), colour, opaque);
     }
 }
 void CGE::DrawTriangle(const Triangle2D& triangle, float rotation)
 {
 
+}
+void CGE::DrawTriangle(const Vector3& point0, const Vector3& point1, const Vector3& point2, const Colour& colour)
+{
+    PROFILE_ZONE("DrawTriangle");
+    COUNT_DRAW(Triangle);
+
+    if (colour.a == 0)
+        return;
+
+    //Depth tiles are in screen space, so the viewport offset is applied to the vertices
+    Vector3 p0(point0.i + viewport.left, point0.j + viewport.bottom, point0.k);
+    Vector3 p1(point1.i + viewport.left, point1.j + viewport.bottom, point1.k);
+    Vector3 p2(point2.i + viewport.left, point2.j + viewport.bottom, point2.k);
+
+    float area = (p1.i - p0.i) * (p2.j - p0.j) - (p1.j - p0.j) * (p2.i - p0.i);
+    if (area == 0)
+        return;
+
+    int L = floorf(min(p0.i, min(p1.i, p2.i))), R = ceilf(max(p0.i, max(p1.i, p2.i)));
+    int D = floorf(min(p0.j, min(p1.j, p2.j))), U = ceilf(max(p0.j, max(p1.j, p2.j)));
+    (L < clip.left) ? L = clip.left : L; (R > clip.right) ? R = clip.right : R;
+    (D < clip.bottom) ? D = clip.bottom : D; (U > clip.top) ? U = clip.top : U;
+    if (L >= R || D >= U)
+        return;
+
+    //Edge functions are scaled by the sign of the area so the inside is always positive
+    float sign = area > 0 ? 1.0f : -1.0f;
+    const Vector3* v[3] = { &p0, &p1, &p2 };
+    float eA[3], eB[3], eC[3];
+    for (int e = 0; e < 3; e++)
+    {
+        const Vector3& a = *v[(e + 1) % 3];
+        const Vector3& b = *v[(e + 2) % 3];
+        eA[e] = (a.j - b.j) * sign;
+        eB[e] = (b.i - a.i) * sign;
+        eC[e] = (a.i * b.j - a.j * b.i) * sign;
+    }
+
+    //Depth is planar across the triangle
+    float dzdx = ((p1.k - p0.k) * (p2.j - p0.j) - (p2.k - p0.k) * (p1.j - p0.j)) / area;
+    float dzdy = ((p2.k - p0.k) * (p1.i - p0.i) - (p1.k - p0.k) * (p2.i - p0.i)) / area;
+    float z0 = p0.k - dzdx * p0.i - dzdy * p0.j;
+    //Reversed depth has the near plane at 1, so nearer means larger
+    const bool reversed = Depth_Buffer::reversed;
+    float nearest = reversed ? max(p0.k, max(p1.k, p2.k)) : min(p0.k, min(p1.k, p2.k));
+
+    const int tileSize = Depth_Buffer::tileSize;
+    Depth_Buffer& depthBuffer = screenBuffer.depthBuffer;
+
+    for (int row = D / tileSize; row <= (U - 1) / tileSize; row++)
+    {
+        int tD = max(row * tileSize, D), tU = min(row * tileSize + tileSize, U);
+
+        for (int column = L / tileSize; column <= (R - 1) / tileSize; column++)
+        {
+            int tL = max(column * tileSize, L), tR = min(column * tileSize + tileSize, R);
+            depthStats.tilesTested++;
+
+            if (hierarchicalDepth)
+            {
+                //Nearest depth the triangle can reach inside this tile, against the farthest depth already stored
+                float tileNear = z0
+                    + dzdx * ((dzdx > 0) != reversed ? tL + 0.5f : tR - 0.5f)
+                    + dzdy * ((dzdy > 0) != reversed ? tD + 0.5f : tU - 0.5f);
+                if (reversed ? tileNear > nearest : tileNear < nearest)
+                    tileNear = nearest;
+
+                if (depthBuffer.TileHidden(column, row, tileNear))
+                {
+                    depthStats.tilesSkipped++;
+                    continue;
+                }
+            }
+
+            bool written = false;
+            for (int h = tD; h < tU; h++)
+            {
+                float y = h + 0.5f;
+                float x = tL + 0.5f;
+                float w0 = eA[0] * x + eB[0] * y + eC[0];
+                float w1 = eA[1] * x + eB[1] * y + eC[1];
+                float w2 = eA[2] * x + eB[2] * y + eC[2];
+                float z = z0 + dzdx * x + dzdy * y;
+
+                for (int w = tL; w < tR; w++)
+                {
+                    if (w0 >= 0 && w1 >= 0 && w2 >= 0)
+                    {
+                        depthStats.fragmentsTested++;
+                        if ((reversed ? z <= 1 : z >= 0) && depthBuffer.Test(screenSize.i * h + w, z))
+                        {
+                            WritePixel(w, h, colour);
+                            written = true;
+                        }
+                    }
+                    w0 += eA[0]; w1 += eA[1]; w2 += eA[2];
+                    z += dzdx;
+                }
+            }
+
+            if (written)
+                depthBuffer.UpdateTile(column, row, screenSize);
+        }
+    }
 }
 void CGE::DrawTriangleLine(const Triangle& triangle, float rotation, const Colour& colour, int thickness)
 {
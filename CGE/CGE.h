@@ -2,67 +2,224 @@
 #include <Windows.h>
 #include <thread>
 #include <string>
+#include <vector>
+#include <functional>
 #include "Colour_Map.h"
+#include "Cell_Quantizer.h"
 #include "Timer.h"
+#include "Frame_Limiter.h"
+#include "Profiler.h"
+#include "Draw_Counters.h"
+#include "Frame_Stats.h"
+#include "Font.h"
+#include "Present_Thread.h"
+#include "Terminal_Presenter.h"
+#include "Job_System.h"
+#include "Asset_Loader.h"
+#include "Frame_Recorder.h"
 #include "Math.h"
 #include "Polygon.h"
+#include "Path.h"
 #include "Image.h"
 #include "Texture.h"
 #include "Sprite.h"
 #include "Screen_Buffer.h"
+#include "Render_Target.h"
+
+//Windows maps DrawText to the GDI DrawTextW, keep the name free for CGE::DrawText
+#undef DrawText
 
 class CGE
 {
 public:
-    HWND consoleHwnd;
-    HANDLE hSTDout;
+    HWND consoleHwnd = nullptr;
+    HANDLE hSTDout = nullptr;
     HANDLE hSTDin;
     CONSOLE_CURSOR_INFO cursorInfo;
     SMALL_RECT windowArea;
     wchar_t windowTitle[64];
     char windowTitleLength = 0;
-    Timer* gameTime;
-    int startTime = 0, endTime = 0, currentDelta = 1;
+    Timer* gameTime = nullptr;
+    double startTime = 0, endTime = 0;
+    //Milliseconds, averaged over the last ten frames
     float deltaTime = 1;
-    int frameTimes[10];
-    char currentFrame = 0;std::thread* titleManager;
+    //Seconds, exactly how long the last frame took. The fixed step loop accumulates this
+    double frameSeconds = 0;
+    float frameTimes[128] = { };
+    int currentFrame = 0;
+    int frameCount = 0;
+    double statsTime = 0, titleTime = 0;
+    Frame_Stats_Channel frameStats;
+    bool showHud = false;
+    bool hudNative = false;
+    Font font;
+    float fixedStep = 0;
+    int maxFixedSteps = 5;
+    Frame_Limiter frameLimiter;
     bool engineActive = true;
     tVector2<int> screenSize;
     bool thirdDimension;
     Colour_Map colourMap;
     Screen_Buffer screenBuffer;
+    //Console cells, screenSize is this times the output mode's cell size
+    tVector2<int> consoleSize;
+    Output_Mode outputMode = Output_Shade;
+    Cell_Quantizer quantizer;
+    //Cells resolved from pixelBuffer in sub-cell modes, null in the shade mode where charBuffer is presented directly
+    CHAR_INFO* cellBuffer = nullptr;
+    //Target draw calls currently write to, null for the console screen
+    Render_Target* renderTarget = nullptr;
+    Present_Thread* presentThread = nullptr;
+    //Built with Present_Headless, frames are drawn and resolved but nothing is presented
+    bool headless = false;
+    //Set when frames go to a VT terminal instead of the console's cells
+    Terminal_Presenter* terminal = nullptr;
+    Job_System* jobs = nullptr;
+    Asset_Loader* assets = nullptr;
+    Frame_Recorder* recorder = nullptr;
+
+    struct Depth_Stats
+    {
+        long long fragmentsTested = 0;
+        long long tilesTested = 0;
+        long long tilesSkipped = 0;
+    };
+    bool hierarchicalDepth = true;
+    Depth_Stats depthStats;
+
+    //Screen pixels with y up, right and top are exclusive
+    struct Clip_Rect
+    {
+        int left, bottom, right, top;
+    };
+    //Draw calls take coordinates relative to the viewport and never touch pixels outside clip,
+    //the intersection of the viewport, the screen and every pushed clip rectangle
+    Clip_Rect viewport;
+    Clip_Rect clip;
+    std::vector<Clip_Rect> clipStack;
+    //The screen's viewport and clips, put aside while a render target is bound
+    Clip_Rect screenViewport;
+    Clip_Rect screenClip;
+    std::vector<Clip_Rect> screenClipStack;
+
+    //Retained mode keeps the last frame, ResetBuffer only clears the rectangles invalidated since and Redraw only draws into them
+    bool retainedMode = false;
+    std::vector<Clip_Rect> invalidRects;
+    //Disjoint screen rectangles cleared by the last ResetBuffer, redrawing points at the one Redraw is drawing
+    std::vector<Clip_Rect> redrawRects;
+    const Clip_Rect* redrawing = nullptr;
+    int maxRedrawRects = 8;
+
+    //Counters for the frame being drawn and the last presented frame, only filled with CGE_COUNTERS
+    Draw_Counters drawCounters;
+    Draw_Counters frameCounters;
+    bool overdrawView = false;
 
-    CGE(LPCWSTR title, const tVector2<int>& pixelSize, const tVector2<int>& screenSize, bool thirdDimension = false);
+    CGE(LPCWSTR title, const tVector2<int>& pixelSize, const tVector2<int>& screenSize, bool thirdDimension = false, Present_Mode presentMode = Present_Console);
     ~CGE();
 
     void virtual Startup();
     void virtual Update();
+    void virtual FixedUpdate();
+    void virtual Render(float alpha);
     void virtual Shutdown();
     void Run();
 
+    void SetFixedStep(float stepsPerSecond);
+    void SetFrameLimit(float framesPerSecond);
+    void SetJobWorkers(int workers, bool pinThreads = false);
+
     void StartTimer();
     void UpdateTimer();
 
     void SetTitle(LPCWSTR title);
     void UpdateTitle();
 
+    void PublishStats();
+    void DrawHud();
+
     void SetBuffer(Colour colour);
     void ResetBuffer();
     void DrawBuffer();
+    //Writes consoleSize cells straight to the console, for frames that were already resolved such as playback.
+    //Skips the screen buffer, the recorder and the present thread, nothing is written in terminal or headless mode
+    void PresentCells(const CHAR_INFO* cells);
+    //Resizes the pixel buffers to the new cell size, call it before starting a recording
+    void SetOutputMode(Output_Mode mode);
+    void Resolve();
+    void ResolveRows(int first, int last);
+    void SetPresentThread(bool enabled);
+    bool StartRecording(const std::string& filePath);
+    void StopRecording();
+    void FinishCounters();
+    CHAR_INFO GetCharInfo(const Colour& colour);
+
+    //Binding a target swaps its buffers and size into screenBuffer and screenSize, the viewport is reset to cover it.
+    //Going back to the screen restores the viewport and clips it had when the first target was bound
+    void SetRenderTarget(Render_Target* target);
+    //Redraws the layer with draw only when it has been invalidated, returns whether it did
+    bool UpdateLayer(Render_Target& layer, const std::function<void()>& draw);
+    //Puts the layer's bottom left corner at x, y in the current viewport. Opaque layers copy rows, opacity scales the layer's alpha
+    void Composite(const Render_Target& layer, int x, int y, Composite_Mode mode = Composite_Alpha, int opacity = 255);
+
+    void SetViewport(int x, int y, int width, int height);
+    void ResetViewport();
+    //x and y are relative to the viewport, the pushed rectangle is also limited to the current clip
+    void PushClip(int x, int y, int width, int height);
+    void PopClip();
+
+    //Switching retained mode on invalidates the whole screen
+    void SetRetainedMode(bool enabled);
+    //x and y are relative to the viewport, the rectangle is cleared and redrawn by the next frame
+    void Invalidate(int x, int y, int width, int height);
+    void InvalidateAll();
+    //Runs draw once for every rectangle the frame is redrawing, clipped to it. Outside retained mode it simply runs draw
+    bool Redraw(const std::function<void()>& draw);
 
     void SetPixel(const tVector2<int>& position, const Colour& colour = { });
     void SetPixel(const Point2D& point);
+    //Screen coordinates, no bounds or transparency checks, callers have already clipped
+    void WritePixel(int x, int y, const Colour& colour);
+    //Screen coordinates tested against clip, blends colour at coverage out of 255 over what is already there
+    void BlendPixel(int x, int y, const Colour& colour, int coverage);
+    //Screen row y from x0 to x1 tested against clip, coverage holds one weight out of 255 per pixel starting at x0
+    void BlendSpan(int y, int x0, int x1, const Colour& colour, const unsigned char* coverage);
 
     void DrawLine(tVector2<int> position1, tVector2<int> position2, const Colour& colour = { });
     void DrawLine(Line line, const Colour& colour = { });
+    void DrawPolyline(const Vector2* points, size_t count, const Colour& colour = { });
+    //Screen coordinates, clips once then steps only the visible part, glyph is the precomputed character for opaque colours or null to blend
+    void RasterLine(int x0, int y0, int x1, int y1, const Colour& colour, const CHAR_INFO* glyph, bool skipFirst);
+    void DrawLineAA(Vector2 position1, Vector2 position2, const Colour& colour = { });
     void DrawLineEx(Vector2 position1, Vector2 position2, const Colour& colour = { }, int thickness = 1);
     void DrawLineEx(Line line, const Colour& colour = { }, int thickness = 1);
+    void DrawPolylineEx(const Vector2* points, size_t count, float thickness, const Colour& colour = { }, Line_Join join = Join_Miter);
+
+    //Writes pixels x0 to x1 of screen row y, already clipped. glyph is the precomputed character for opaque colours or null to blend
+    void FillSpan(int y, int x0, int x1, const Colour& colour, const CHAR_INFO* glyph);
+    void ClipSpan(int y, int x0, int x1, const Colour& colour, const CHAR_INFO* glyph);
+    void FillPath(const Path& path, const Colour& colour, Fill_Rule rule = Fill_NonZero);
+
+    //Scan conversion in screen coordinates, span(y, x0, x1) receives each covered run already clipped.
+    //Convex polygons write their left and right edges into edgeBuffer, anything else goes through the active edge table
+    template <int s>
+    void ScanPoly(const Vector2 (&points)[s], Fill_Rule rule, const std::function<void(int, int, int)>& span);
+    void ScanEdge(const Vector2& a, const Vector2& b, bool right);
+    void ScanEdgeBuffer(float bottom, float top, const std::function<void(int, int, int)>& span);
+    void ScanPolygon(const Vector2* points, const int* contourEnds, int contourCount, Fill_Rule rule, const std::function<void(int, int, int)>& span, const Vector2& offset = Vector2());
+    int FanWeights(const Vector2* points, int count, const Vector2& centre, const Vector2& position, float& weightCentre, float& weight0, float& weight1);
+    void ShadeSpan(const Vector2* points, const Colour* colours, int count, int y, int x0, int x1);
+    void TextureSpan(const Vector2* points, const Vector2* texels, int count, const Texture& texture, int y, int x0, int x1);
+
+    void DrawText(const std::string& text, const tVector2<int>& position, const Colour& colour = { }, int scale = 1);
+    void DrawTextNative(const std::string& text, const tVector2<int>& position, const Colour& colour = { }, const Colour& background = { });
 
     void DrawEdge(Edge2D edge);
     void DrawEdgeEx(Edge2D edge, int thickness = 1);
     //Zone drawing functions
     void DrawCircle(const Vector2& position, float radius, const Colour& colour = { });
     void DrawCircle(const Circle& circle, const Colour& colour = { });
+    void DrawCircleAA(const Vector2& position, float radius, const Colour& colour = { });
     void DrawCircleLine(const Vector2& position, float radius, const Colour& colour = { }, int thickness = 1);
     void DrawCircleLine(const Circle& circle, const Colour& colour = { }, int thickness = 1);
 
@@ -85,16 +242,17 @@ public:
     void DrawTriangle(const Vector2& p0, const Vector2& p1, const Vector2& p2, const Colour& colour = { });
     void DrawTriangle(const Triangle& triangle, float rotation = 0, const Colour& colour = { });
     void DrawTriangle(const Triangle2D& triangle, float rotation = 0);
+    void DrawTriangle(const Vector3& p0, const Vector3& p1, const Vector3& p2, const Colour& colour = { });
     void DrawTriangleLine(const Triangle& triangle, float rotation = 0, const Colour& colour = { }, int thickness = 1);
     void DrawTriangleTexture(const Triangle& source, const Triangle& dest, const Texture& texture, float sourceRot = 0, float destRot = 0);
     void DrawTriangleTexture(const vTriangle2D& triangle, const Texture& texture, float rotation = 0);
 
     template <int s>
-    void DrawPoly(const Poly<s>& poly, float rotation = 0, const Colour& colour = { });
+    void DrawPoly(const Poly<s>& poly, float rotation = 0, const Colour& colour = { }, Fill_Rule rule = Fill_NonZero);
     template <int s>
     void DrawPolyLine(const Poly<s>& poly, float rotation = 0, const Colour& colour = { }, int thickness = 1);
     template <int s>
-    void DrawShape(const Shape<s>& shape, float rotation = 0);
+    void DrawShape(const Shape<s>& shape, float rotation = 0, Fill_Rule rule = Fill_NonZero);
     template <int s>
     void DrawShapeTexture(const Poly<s>& source, const Poly<s>& dest, const Texture& texture, float sourceRot = 0, float destRot = 0);
     template <int s>
@@ -102,27 +260,167 @@ public:
 };
 
 template <int s>
-void CGE::DrawPoly(const Poly<s>& poly, float rotation, const Colour& colour)
+void CGE::ScanPoly(const Vector2 (&points)[s], Fill_Rule rule, const std::function<void(int, int, int)>& span)
+{
+    //Convex when every corner turns the same way and the outline only changes vertical direction twice
+    float area = 0;
+    float bottom = points[0].j, top = points[0].j;
+    float firstDy = 0, lastDy = 0;
+    int turns = 0, directionChanges = 0;
+    auto corner = [&](int i)
+    {
+        const Vector2& a = points[i];
+        const Vector2& b = points[(i + 1) % s];
+        const Vector2& c = points[(i + 2) % s];
+        area += a.i * b.j - b.i * a.j;
+        if (b.j < bottom) bottom = b.j;
+        if (b.j > top) top = b.j;
+
+        float cross = (b.i - a.i) * (c.j - b.j) - (b.j - a.j) * (c.i - b.i);
+        turns |= cross > 0 ? 1 : cross < 0 ? 2 : 0;
+
+        float dy = b.j - a.j;
+        if (dy != 0)
+        {
+            if (lastDy != 0 && (dy > 0) != (lastDy > 0))
+                directionChanges++;
+            if (firstDy == 0)
+                firstDy = dy;
+            lastDy = dy;
+        }
+    };
+    Unroll<0, s>::Run(corner);
+    if (area == 0 || top <= clip.bottom + 0.5f || bottom > clip.top - 0.5f)
+        return;
+    if ((firstDy > 0) != (lastDy > 0))
+        directionChanges++;
+
+    if (turns == 3 || directionChanges > 2)
+    {
+        int end = s;
+        ScanPolygon(points, &end, 1, rule, span);
+        return;
+    }
+
+    //Counter-clockwise outlines climb on the right, each edge fills one side of the rows it spans
+    bool counterClockwise = area > 0;
+    auto edge = [&](int i) { ScanEdge(points[i], points[(i + 1) % s], (points[(i + 1) % s].j > points[i].j) == counterClockwise); };
+    Unroll<0, s>::Run(edge);
+    ScanEdgeBuffer(bottom, top, span);
+}
+
+template <int s>
+void CGE::DrawPoly(const Poly<s>& poly, float rotation, const Colour& colour, Fill_Rule rule)
 {
-    //NEEDS WORK
+    PROFILE_ZONE("DrawPoly");
+    COUNT_DRAW(Poly);
+
+    if (colour.a == 0)
+        return;
+
+    float c = cosf(rotation), n = sinf(rotation);
+    Vector2 origin((float)viewport.left + poly.position.i, (float)viewport.bottom + poly.position.j);
+    Vector2 points[s];
+    auto place = [&](int i) { points[i] = { origin.i + poly.point[i].i * c - poly.point[i].j * n, origin.j + poly.point[i].i * n + poly.point[i].j * c }; };
+    Unroll<0, s>::Run(place);
+
+    CHAR_INFO glyph = GetCharInfo(colour);
+    const CHAR_INFO* opaque = colour.a == 255 ? &glyph : nullptr;
+    ScanPoly(points, rule, [&](int y, int x0, int x1) { FillSpan(y, x0, x1, colour, opaque); });
 }
 template <int s>
 void CGE::DrawPolyLine(const Poly<s>& poly, float rotation, const Colour& colour, int thickness)
 {
-    //NEEDS WORK
+    PROFILE_ZONE("DrawPolyLine");
+    COUNT_DRAW(Poly);
+
+    if (colour.a == 0 || thickness < 1)
+        return;
+
+    //Closed by repeating the first two points, so the first corner gets a join like the others
+    float c = cosf(rotation), n = sinf(rotation);
+    Vector2 points[s + 2];
+    auto place = [&](int i) { points[i] = { poly.position.i + poly.point[i].i * c - poly.point[i].j * n, poly.position.j + poly.point[i].i * n + poly.point[i].j * c }; };
+    Unroll<0, s>::Run(place);
+    points[s] = points[0];
+    points[s + 1] = points[1];
+
+    if (thickness == 1)
+    {
+        DrawPolyline(points, s + 1, colour);
+        return;
+    }
+
+    Path stroke;
+    stroke.Stroke(points, s + 2, (float)thickness);
+    FillPath(stroke, colour);
 }
 template <int s>
-void CGE::DrawShape(const Shape<s>& shape, float rotation)
+void CGE::DrawShape(const Shape<s>& shape, float rotation, Fill_Rule rule)
 {
-    //NEEDS WORK
+    PROFILE_ZONE("DrawShape");
+    COUNT_DRAW(Poly);
+
+    float c = cosf(rotation), n = sinf(rotation);
+    Vector2 origin((float)viewport.left + shape.position.i, (float)viewport.bottom + shape.position.j);
+    Vector2 points[s];
+    Colour colours[s];
+    auto place = [&](int i)
+    {
+        const Vector2& point = shape.point[i].position;
+        points[i] = { origin.i + point.i * c - point.j * n, origin.j + point.i * n + point.j * c };
+        colours[i] = shape.point[i].colour;
+    };
+    Unroll<0, s>::Run(place);
+
+    //Colours blend across a fan from the centre, which matches Gouraud shading for convex shapes
+    ScanPoly(points, rule, [&](int y, int x0, int x1) { ShadeSpan(points, colours, s, y, x0, x1); });
 }
 template <int s>
 void CGE::DrawShapeTexture(const Poly<s>& source, const Poly<s>& dest, const Texture& texture, float sourceRot, float destRot)
 {
-    //NEEDS WORK
+    PROFILE_ZONE("DrawShapeTexture");
+    COUNT_DRAW(Poly);
+
+    if (!texture.data)
+        return;
+
+    //Source points are in texels, dest points on screen
+    float sc = cosf(sourceRot), sn = sinf(sourceRot);
+    float dc = cosf(destRot), dn = sinf(destRot);
+    Vector2 origin((float)viewport.left + dest.position.i, (float)viewport.bottom + dest.position.j);
+    Vector2 points[s];
+    Vector2 texels[s];
+    auto place = [&](int i)
+    {
+        points[i] = { origin.i + dest.point[i].i * dc - dest.point[i].j * dn, origin.j + dest.point[i].i * dn + dest.point[i].j * dc };
+        texels[i] = { source.position.i + source.point[i].i * sc - source.point[i].j * sn, source.position.j + source.point[i].i * sn + source.point[i].j * sc };
+    };
+    Unroll<0, s>::Run(place);
+
+    ScanPoly(points, Fill_NonZero, [&](int y, int x0, int x1) { TextureSpan(points, texels, s, texture, y, x0, x1); });
 }
 template <int s>
 void CGE::DrawShapeTexture(const vShape<s>& shape, const Texture& texture, float rotation)
 {
-    //NEEDS WORK
-}
\ No newline at end of file
+    PROFILE_ZONE("DrawShapeTexture");
+    COUNT_DRAW(Poly);
+
+    if (!texture.data)
+        return;
+
+    //Vertex texels are 0 to 1 across the texture
+    float c = cosf(rotation), n = sinf(rotation);
+    Vector2 origin((float)viewport.left + shape.position.i, (float)viewport.bottom + shape.position.j);
+    Vector2 points[s];
+    Vector2 texels[s];
+    auto place = [&](int i)
+    {
+        const Vertex2D& vertex = shape.vertex[i];
+        points[i] = { origin.i + vertex.position.i * c - vertex.position.j * n, origin.j + vertex.position.i * n + vertex.position.j * c };
+        texels[i] = { vertex.texel.i * texture.textureWidth, vertex.texel.j * texture.textureHeight };
+    };
+    Unroll<0, s>::Run(place);
+
+    ScanPoly(points, Fill_NonZero, [&](int y, int x0, int x1) { TextureSpan(points, texels, s, texture, y, x0, x1); });
+}
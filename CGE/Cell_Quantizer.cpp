@@ -0,0 +1,158 @@
+#include <climits>
+#include "Cell_Quantizer.h"
+#include "Colour_Map.h"
+
+//Glyphs for the shade levels packed into bits 8 and 9 of a colourCube entry, as CGE::GetCharInfo picks them
+static const wchar_t shadeGlyphs[4] = { L'\x2588', L'\x2593', L'\x2592', L'\x2591' };
+//Top left, top right, bottom left and bottom right quadrants for bits 0 to 3
+static const wchar_t quadrants[16] =
+{
+	L' ', L'\x2598', L'\x259D', L'\x2580', L'\x2596', L'\x258C', L'\x259E', L'\x259B',
+	L'\x2597', L'\x259A', L'\x2590', L'\x259C', L'\x2584', L'\x2599', L'\x259F', L'\x2588'
+};
+//Braille dot numbers count down the left column then the right, with the bottom row added last as dots 7 and 8
+static const int brailleDots[8] = { 0, 3, 1, 4, 2, 5, 6, 7 };
+
+void Cell_Quantizer::Initialise(const Colour_Map& colourMap)
+{
+	for (int i = 0; i < 16; i++)
+		palette[i] = colourMap.consoleColours[i];
+	colourCube = colourMap.colourCube;
+
+	for (int i = 0; i < 16; i++)
+		quadrantGlyphs[i] = quadrants[i];
+	for (int pattern = 0; pattern < 256; pattern++)
+	{
+		int dots = 0;
+		for (int pixel = 0; pixel < 8; pixel++)
+			if (pattern & (1 << pixel)) dots |= 1 << brailleDots[pixel];
+		brailleGlyphs[pattern] = (wchar_t)(0x2800 + dots);
+	}
+
+	//Matched from the middle of each bucket, 4096 x 16 distances is well under a millisecond
+	for (int i = 0; i < 4096; i++)
+	{
+		Colour colour((i & 0xF) * 16 + 8, ((i >> 4) & 0xF) * 16 + 8, (i >> 8) * 16 + 8);
+		int closest = 0;
+		for (int j = 1; j < 16; j++)
+			if (Distance(colour, palette[j]) < Distance(colour, palette[closest]))
+				closest = j;
+		nearest[i] = (unsigned char)closest;
+	}
+}
+
+tVector2<int> Cell_Quantizer::CellSize(Output_Mode mode)
+{
+	switch (mode)
+	{
+	case Output_HalfBlock:
+		return { 1, 2 };
+	case Output_Quadrant:
+		return { 2, 2 };
+	case Output_Braille:
+		return { 2, 4 };
+	default:
+		return { 1, 1 };
+	}
+}
+
+CHAR_INFO Cell_Quantizer::HalfBlock(const Colour& top, const Colour& bottom) const
+{
+	CHAR_INFO cell;
+	int upper = Nearest(top);
+	int lower = Nearest(bottom);
+	int error = Distance(top, palette[upper]) + Distance(bottom, palette[lower]);
+
+	//Two pixels close to each other are often better served by the 376 blended shades than by two flat colours
+	wchar_t entry = colourCube[(top.r + bottom.r) / 2 + (top.g + bottom.g) / 2 * 256 + (top.b + bottom.b) / 2 * 65536];
+	Colour shade = ShadeColour(entry);
+	if (Distance(top, shade) + Distance(bottom, shade) < error)
+	{
+		cell.Char.UnicodeChar = shadeGlyphs[(entry >> 8) & 3];
+		cell.Attributes = entry & 0xFF;
+		return cell;
+	}
+
+	cell.Char.UnicodeChar = L'\x2580';
+	cell.Attributes = (WORD)(upper | (lower << 4));
+	return cell;
+}
+
+CHAR_INFO Cell_Quantizer::Pattern(const Colour* pixels, int count, const wchar_t* glyphs) const
+{
+	//Candidates are the nearest palette entries of the pixels themselves
+	int candidates[8];
+	int candidateCount = 0;
+	for (int pixel = 0; pixel < count; pixel++)
+	{
+		int index = Nearest(pixels[pixel]);
+		int c = 0;
+		while (c < candidateCount && candidates[c] != index)
+			c++;
+		if (c == candidateCount)
+			candidates[candidateCount++] = index;
+	}
+
+	CHAR_INFO cell;
+	if (candidateCount == 1)
+	{
+		cell.Char.UnicodeChar = glyphs[0];
+		cell.Attributes = (WORD)(candidates[0] | (candidates[0] << 4));
+		return cell;
+	}
+
+	int distance[8][8];
+	for (int pixel = 0; pixel < count; pixel++)
+		for (int c = 0; c < candidateCount; c++)
+			distance[pixel][c] = Distance(pixels[pixel], palette[candidates[c]]);
+
+	int bestError = INT_MAX, bestFore = 0, bestBack = 1, bestPattern = 0;
+	for (int fore = 0; fore < candidateCount; fore++)
+	{
+		for (int back = fore + 1; back < candidateCount; back++)
+		{
+			int error = 0, pattern = 0;
+			for (int pixel = 0; pixel < count; pixel++)
+			{
+				if (distance[pixel][fore] < distance[pixel][back])
+				{
+					error += distance[pixel][fore];
+					pattern |= 1 << pixel;
+				}
+				else
+					error += distance[pixel][back];
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				bestFore = fore;
+				bestBack = back;
+				bestPattern = pattern;
+			}
+		}
+	}
+
+	cell.Char.UnicodeChar = glyphs[bestPattern];
+	cell.Attributes = (WORD)(candidates[bestFore] | (candidates[bestBack] << 4));
+	return cell;
+}
+
+int Cell_Quantizer::Distance(const Colour& lhs, const Colour& rhs)
+{
+	int r = lhs.r - rhs.r, g = lhs.g - rhs.g, b = lhs.b - rhs.b;
+	return r * r + g * g + b * b;
+}
+
+Colour Cell_Quantizer::ShadeColour(wchar_t entry) const
+{
+	int level = (entry >> 8) & 3;
+	const Colour& back = palette[(entry >> 4) & 0xF];
+	const Colour& fore = palette[entry & 0xF];
+	if (level == 0)
+		return fore;
+
+	//Same rounding the colour map used when it made the shade
+	return Colour((int)(back.r * level * 0.25f + fore.r * (4 - level) * 0.25f),
+		(int)(back.g * level * 0.25f + fore.g * (4 - level) * 0.25f),
+		(int)(back.b * level * 0.25f + fore.b * (4 - level) * 0.25f));
+}
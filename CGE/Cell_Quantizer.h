@@ -0,0 +1,44 @@
+#pragma once
+#include <Windows.h>
+#include "Colour.h"
+#include "Math.h"
+
+class Colour_Map;
+
+//How pixels become console cells. Shade gives every pixel its own cell, the others pack several pixels into one
+enum Output_Mode
+{
+	Output_Shade,
+	Output_HalfBlock,
+	//2x2 pixels per cell with the quadrant block characters
+	Output_Quadrant,
+	//2x4 pixels per cell as Braille dots, best for lines and wireframes
+	Output_Braille
+};
+
+//Turns the pixels covered by one console cell into the glyph and colour pair that matches them best
+class Cell_Quantizer
+{
+public:
+	Colour palette[16];
+	//Nearest palette entry for every colour with 4 bits per channel
+	unsigned char nearest[4096];
+	const wchar_t* colourCube;
+	//Glyph for every foreground pattern, bit i set when pixel i counting from the top left row by row is foreground
+	wchar_t quadrantGlyphs[16];
+	wchar_t brailleGlyphs[256];
+
+	void Initialise(const Colour_Map& colourMap);
+	//Pixels across and up covered by one cell
+	static tVector2<int> CellSize(Output_Mode mode);
+
+	//Upper half block with the top pixel as foreground, or the shade glyph for their average when that is closer
+	CHAR_INFO HalfBlock(const Colour& top, const Colour& bottom) const;
+	//Picks the pair of palette entries that best splits count pixels, at most 8, and the glyph drawing that split
+	CHAR_INFO Pattern(const Colour* pixels, int count, const wchar_t* glyphs) const;
+
+	int Nearest(const Colour& colour) const { return nearest[(colour.r >> 4) | (colour.g & 0xF0) | ((colour.b & 0xF0) << 4)]; }
+	static int Distance(const Colour& lhs, const Colour& rhs);
+	//Colour a colourCube entry shows, the mix its shade glyph makes of two palette entries
+	Colour ShadeColour(wchar_t entry) const;
+};
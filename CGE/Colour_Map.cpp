@@ -10,7 +10,14 @@ Colour_Map::Colour_Map()
     cursorInfo.bVisible = FALSE;
     SetConsoleCursorInfo(GetStdHandle(STD_OUTPUT_HANDLE), &cursorInfo);
 
-    
+    colourCube = nullptr;
+}
+
+void Colour_Map::Load()
+{
+    if (colourCube)
+        return;
+
     colourCube = new WCHAR[256 * 256 * 256];
 
     bool fileFound = false;
@@ -93,4 +100,21 @@ Colour_Map::Colour_Map()
 Colour_Map::~Colour_Map()
 {
     delete[] colourCube;
+}
+
+int Colour_Map::GetConsoleColour(const Colour& colour) const
+{
+    int closest = 0;
+    int diff = 195076;
+    for (int i = 0; i < 16; i++)
+    {
+        const Colour& current = consoleColours[i];
+        int newDiff = (colour.r - current.r) * (colour.r - current.r) + (colour.g - current.g) * (colour.g - current.g) + (colour.b - current.b) * (colour.b - current.b);
+        if (newDiff < diff)
+        {
+            closest = i;
+            diff = newDiff;
+        }
+    }
+    return closest;
 }
\ No newline at end of file
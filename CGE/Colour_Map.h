@@ -25,10 +25,15 @@ public:
         /*White         */  { 170, 170, 170 }
     };
 
+    //Null until Load, terminal presenters work from pixel colours and never load it
     wchar_t* colourCube;
 
     Colour_Map();
+    //Reads colours.map, or builds and writes it when it doesn't exist yet
+    void Load();
 
     ~Colour_Map();
+
+    int GetConsoleColour(const Colour& colour) const;
 };
 
@@ -0,0 +1,178 @@
+#pragma once
+#include "Math.h"
+
+//Depth formats. Depths are given to Encode in [0, 1] with 0 at the near plane, except for Depth_Reversed.
+struct Depth_Float
+{
+	typedef float Type;
+	static const bool reversed = false;
+	static Type Near() { return 0.0f; }
+	static Type Far() { return 1.0f; }
+	static Type Encode(float depth) { return depth; }
+	static bool Closer(Type lhs, Type rhs) { return lhs < rhs; }
+};
+
+//Callers pass 1 - z, so 1 is the near plane and 0 is far. The flip has to happen in the caller's projection,
+//floats are densest near 0 so that is where the far plane's precision comes from
+struct Depth_Reversed
+{
+	typedef float Type;
+	static const bool reversed = true;
+	static Type Near() { return 1.0f; }
+	static Type Far() { return 0.0f; }
+	static Type Encode(float depth) { return depth; }
+	static bool Closer(Type lhs, Type rhs) { return lhs > rhs; }
+};
+
+struct Depth_Unorm16
+{
+	typedef unsigned short Type;
+	static const bool reversed = false;
+	static Type Near() { return 0; }
+	static Type Far() { return 0xFFFF; }
+	//Conservative tile depths can fall below 0
+	static Type Encode(float depth) { return depth <= 0.0f ? 0 : depth >= 1.0f ? 0xFFFF : (Type)(depth * 65535.0f); }
+	static bool Closer(Type lhs, Type rhs) { return lhs < rhs; }
+};
+
+template <typename Format>
+class tDepth_Buffer
+{
+public:
+	typedef typename Format::Type Type;
+
+	//Farthest depth stored in each tileSize x tileSize block
+	static const int tileSize = 8;
+	static const bool reversed = Format::reversed;
+
+	Type* data;
+	Type* tiles;
+	tVector2<int> tileCount;
+
+	tDepth_Buffer();
+	~tDepth_Buffer();
+
+	void Initialise(const tVector2<int>& screenSize);
+	void Release();
+	void Swap(tDepth_Buffer& other);
+
+	void Reset(int screenArea);
+	void Set(int screenArea, Type depth);
+	//Tiles touching the rectangle go back to far, which only ever makes the tile test more conservative
+	void ResetRect(const tVector2<int>& screenSize, int left, int bottom, int right, int top);
+
+	static Type Encode(float depth) { return Format::Encode(depth); }
+
+	bool Test(int index, float depth);
+	bool TileHidden(int column, int row, float nearest) const;
+	void UpdateTile(int column, int row, const tVector2<int>& screenSize);
+};
+
+#if defined(CGE_DEPTH_UNORM16)
+typedef tDepth_Buffer<Depth_Unorm16> Depth_Buffer;
+#elif defined(CGE_DEPTH_REVERSED)
+typedef tDepth_Buffer<Depth_Reversed> Depth_Buffer;
+#else
+typedef tDepth_Buffer<Depth_Float> Depth_Buffer;
+#endif
+
+#pragma region tDepth_Buffer
+template <typename Format>
+tDepth_Buffer<Format>::tDepth_Buffer()
+{
+	data = nullptr;
+	tiles = nullptr;
+}
+template <typename Format>
+tDepth_Buffer<Format>::~tDepth_Buffer()
+{
+	delete[] data;
+	delete[] tiles;
+}
+template <typename Format>
+void tDepth_Buffer<Format>::Initialise(const tVector2<int>& screenSize)
+{
+	data = new Type[screenSize.i * screenSize.j];
+	tileCount.i = (screenSize.i + tileSize - 1) / tileSize;
+	tileCount.j = (screenSize.j + tileSize - 1) / tileSize;
+	tiles = new Type[tileCount.i * tileCount.j];
+}
+template <typename Format>
+void tDepth_Buffer<Format>::Release()
+{
+	delete[] data;
+	delete[] tiles;
+	data = nullptr;
+	tiles = nullptr;
+}
+template <typename Format>
+void tDepth_Buffer<Format>::Swap(tDepth_Buffer& other)
+{
+	Type* otherData = other.data;
+	Type* otherTiles = other.tiles;
+	tVector2<int> otherTileCount = other.tileCount;
+	other.data = data;
+	other.tiles = tiles;
+	other.tileCount = tileCount;
+	data = otherData;
+	tiles = otherTiles;
+	tileCount = otherTileCount;
+}
+template <typename Format>
+void tDepth_Buffer<Format>::Reset(int screenArea)
+{
+	Set(screenArea, Format::Far());
+}
+template <typename Format>
+void tDepth_Buffer<Format>::Set(int screenArea, Type depth)
+{
+	for (int i = 0; i < screenArea; i++)
+		data[i] = depth;
+	for (int i = 0; i < tileCount.i * tileCount.j; i++)
+		tiles[i] = depth;
+}
+template <typename Format>
+void tDepth_Buffer<Format>::ResetRect(const tVector2<int>& screenSize, int left, int bottom, int right, int top)
+{
+	for (int h = bottom; h < top; h++)
+		for (int w = left; w < right; w++)
+			data[screenSize.i * h + w] = Format::Far();
+	for (int row = bottom / tileSize; row <= (top - 1) / tileSize; row++)
+		for (int column = left / tileSize; column <= (right - 1) / tileSize; column++)
+			tiles[tileCount.i * row + column] = Format::Far();
+}
+template <typename Format>
+bool tDepth_Buffer<Format>::Test(int index, float depth)
+{
+	Type encoded = Format::Encode(depth);
+	if (!Format::Closer(encoded, data[index]))
+		return false;
+
+	data[index] = encoded;
+	return true;
+}
+template <typename Format>
+bool tDepth_Buffer<Format>::TileHidden(int column, int row, float nearest) const
+{
+	return !Format::Closer(Format::Encode(nearest), tiles[tileCount.i * row + column]);
+}
+template <typename Format>
+void tDepth_Buffer<Format>::UpdateTile(int column, int row, const tVector2<int>& screenSize)
+{
+	int L = column * tileSize, R = L + tileSize;
+	int D = row * tileSize, U = D + tileSize;
+	if (R > screenSize.i) R = screenSize.i;
+	if (U > screenSize.j) U = screenSize.j;
+
+	//Start from the nearest representable depth and walk outwards
+	Type farthest = Format::Near();
+	for (int h = D; h < U; h++)
+	{
+		const Type* depth = data + screenSize.i * h;
+		for (int w = L; w < R; w++)
+			if (Format::Closer(farthest, depth[w])) farthest = depth[w];
+	}
+
+	tiles[tileCount.i * row + column] = farthest;
+}
+#pragma endregion
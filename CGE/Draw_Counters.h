@@ -0,0 +1,42 @@
+#pragma once
+
+//Define CGE_COUNTERS to compile the counters in, otherwise COUNT_DRAW and COUNT_PIXEL expand to nothing.
+#if defined(CGE_COUNTERS)
+#define COUNT_DRAW(type) drawCounters.drawCalls[Draw_Counters::type]++
+#define COUNT_PIXEL(counter) drawCounters.counter++
+#define COUNT_OVERDRAW(index) screenBuffer.overdrawBuffer[index] += screenBuffer.overdrawBuffer[index] < 255
+#else
+#define COUNT_DRAW(type)
+#define COUNT_PIXEL(counter)
+#define COUNT_OVERDRAW(index)
+#endif
+
+struct Draw_Counters
+{
+	enum Draw_Type
+	{
+		Line,
+		LineEx,
+		Circle,
+		CircleLine,
+		Oval,
+		OvalLine,
+		Rect,
+		RectLine,
+		Triangle,
+		Poly,
+		Layer,
+		Draw_Type_Count
+	};
+
+	long long drawCalls[Draw_Type_Count] = { };
+	long long pixelsWritten = 0;
+	long long pixelsBlended = 0;
+	long long pixelsClipped = 0;
+	long long pixelsTransparent = 0;
+	long long pixelsCovered = 0;
+
+	//Average number of writes to each pixel that was written at least once
+	float Overdraw() const { return pixelsCovered ? (float)pixelsWritten / pixelsCovered : 0; }
+	void Reset() { *this = Draw_Counters(); }
+};
@@ -0,0 +1,19 @@
+#pragma once
+
+class Font
+{
+public:
+	static const int firstGlyph = 32;
+	static const int glyphCount = 95;
+
+	int glyphWidth;
+	int glyphHeight;
+
+	//One bitmask per glyph row, bit 0 is the leftmost column
+	unsigned char* atlas;
+
+	Font();
+	~Font();
+
+	const unsigned char* GetGlyph(char character) const;
+};
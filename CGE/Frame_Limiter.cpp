@@ -0,0 +1,63 @@
+#include "Frame_Limiter.h"
+#pragma comment(lib, "winmm.lib")
+
+Frame_Limiter::Frame_Limiter()
+{
+    period = 0;
+    deadline = 0;
+
+    //High resolution waitable timers wake within ~0.5ms, older systems need the 1ms system timer period instead
+    waitTimer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    highResolution = waitTimer != NULL;
+    if (!highResolution)
+        timeBeginPeriod(1);
+}
+Frame_Limiter::~Frame_Limiter()
+{
+    if (highResolution)
+        CloseHandle(waitTimer);
+    else
+        timeEndPeriod(1);
+}
+
+void Frame_Limiter::SetRate(float framesPerSecond)
+{
+    period = framesPerSecond > 0 ? 1.0 / framesPerSecond : 0;
+    deadline = clock.elapsed() + period;
+}
+void Frame_Limiter::Wait()
+{
+    if (period <= 0)
+        return;
+
+    double now = clock.elapsed();
+
+    //Running more than a frame behind, drop the missed frames rather than rushing to catch up
+    if (now > deadline + period)
+        deadline = now;
+
+    //Sleep through most of the wait, then yield for the last stretch the scheduler can't hit precisely
+    double slack = highResolution ? 0.0005 : 0.002;
+    if (deadline - now > slack)
+        SleepFor(deadline - now - slack);
+
+    while (clock.elapsed() < deadline)
+        SwitchToThread();
+
+    deadline += period;
+}
+
+void Frame_Limiter::SleepFor(double seconds)
+{
+    if (!highResolution)
+    {
+        Sleep((DWORD)(seconds * 1000));
+        return;
+    }
+
+    //Relative due time in 100ns units
+    LARGE_INTEGER dueTime;
+    dueTime.QuadPart = -(LONGLONG)(seconds * 10000000);
+    SetWaitableTimer(waitTimer, &dueTime, 0, NULL, NULL, FALSE);
+    WaitForSingleObject(waitTimer, INFINITE);
+}
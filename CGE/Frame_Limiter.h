@@ -0,0 +1,23 @@
+#pragma once
+#include <Windows.h>
+#include "Timer.h"
+
+class Frame_Limiter
+{
+public:
+    Frame_Limiter();
+    ~Frame_Limiter();
+
+    void SetRate(float framesPerSecond);
+    void Wait();
+
+    double period;
+    double deadline;
+
+private:
+    void SleepFor(double seconds);
+
+    Timer clock;
+    HANDLE waitTimer;
+    bool highResolution;
+};
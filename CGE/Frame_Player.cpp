@@ -0,0 +1,239 @@
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include "Frame_Player.h"
+#include "Frame_Recorder.h"
+#include "CGE.h"
+
+Frame_Player::Frame_Player()
+{
+	screenSize = { 0, 0 };
+	frame = nullptr;
+	timestamp = 0;
+	frameIndex = 0;
+}
+
+Frame_Player::~Frame_Player()
+{
+	Close();
+}
+
+bool Frame_Player::Open(const std::string& filePath)
+{
+	Close();
+
+	file.open(filePath, std::ios::binary | std::ios::in);
+	if (!file.is_open())
+		return false;
+
+	char magic[4];
+	int version;
+	file.read(magic, 4);
+	file.read((char*)&version, sizeof(int));
+	file.read((char*)&screenSize.i, sizeof(int));
+	file.read((char*)&screenSize.j, sizeof(int));
+	if (file.fail() || memcmp(magic, "CGER", 4) != 0 || version != Frame_Recorder::version || screenSize.i <= 0 || screenSize.j <= 0)
+	{
+		Close();
+		return false;
+	}
+
+	frame = new CHAR_INFO[screenSize.i * screenSize.j]();
+	timestamp = 0;
+	frameIndex = 0;
+	return true;
+}
+
+void Frame_Player::Close()
+{
+	if (file.is_open())
+		file.close();
+	delete[] frame;
+	frame = nullptr;
+}
+
+bool Frame_Player::NextFrame()
+{
+	if (!frame)
+		return false;
+
+	unsigned int payloadSize;
+	file.read((char*)&timestamp, sizeof(double));
+	file.read((char*)&payloadSize, sizeof(unsigned int));
+	if (file.fail())
+		return false;
+
+	payload.resize(payloadSize);
+	file.read((char*)payload.data(), payloadSize);
+	if (file.fail())
+		return false;
+
+	int screenArea = screenSize.i * screenSize.j;
+	unsigned char* cells = (unsigned char*)frame;
+	const unsigned char* input = payload.data();
+	const unsigned char* end = input + payloadSize;
+
+	int i = 0;
+	while (input < end)
+	{
+		unsigned int token;
+		input = Frame_Recorder::ReadVarint(input, end, token);
+		if (!input)
+			return false;
+
+		int kind = token & 3;
+		int run = (int)(token >> 2);
+		if (run > screenArea - i)
+			return false;
+
+		if (kind == Frame_Recorder::Token_Repeat || kind == Frame_Recorder::Token_Literal)
+		{
+			if (end - input < (kind == Frame_Recorder::Token_Repeat ? 4 : 4ll * run))
+				return false;
+
+			for (int k = 0; k < run; k++)
+			{
+				unsigned int value, delta;
+				memcpy(&value, cells + (i + k) * 4, 4);
+				memcpy(&delta, input + (kind == Frame_Recorder::Token_Literal ? k * 4 : 0), 4);
+				value ^= delta;
+				memcpy(cells + (i + k) * 4, &value, 4);
+			}
+			input += kind == Frame_Recorder::Token_Repeat ? 4 : 4 * run;
+		}
+		else if (kind != Frame_Recorder::Token_Skip)
+			return false;
+
+		i += run;
+	}
+
+	frameIndex++;
+	return true;
+}
+
+long long Frame_Player::Play(CGE* engine, bool realTime)
+{
+	//Recordings hold console cells, so they have to match the console whatever the output mode
+	if (engine->consoleSize.i != screenSize.i || engine->consoleSize.j != screenSize.j)
+		return 0;
+
+	long long played = 0;
+	Timer timer;
+	while (NextFrame())
+	{
+		if (realTime)
+		{
+			double wait = timestamp - timer.elapsed();
+			if (wait > 0)
+				std::this_thread::sleep_for(std::chrono::duration<double>(wait));
+		}
+
+		//The cells are already resolved, going through DrawBuffer would resolve the pixel buffer over them
+		engine->PresentCells(frame);
+		played++;
+	}
+
+	return played;
+}
+
+static void AppendUtf8(std::string& output, wchar_t character)
+{
+	//Console glyphs are all in the basic multilingual plane
+	unsigned int c = (unsigned int)character;
+	if (c < 0x80)
+		output += (char)c;
+	else if (c < 0x800)
+	{
+		output += (char)(0xC0 | c >> 6);
+		output += (char)(0x80 | (c & 0x3F));
+	}
+	else
+	{
+		output += (char)(0xE0 | c >> 12);
+		output += (char)(0x80 | (c >> 6 & 0x3F));
+		output += (char)(0x80 | (c & 0x3F));
+	}
+}
+
+static void AppendColours(std::string& output, const Colour_Map& colourMap, int attributes)
+{
+	//The engine replaces the console palette with consoleColours, so the stock ANSI colours would be wrong
+	const Colour& fore = colourMap.consoleColours[attributes & 0xF];
+	const Colour& back = colourMap.consoleColours[attributes >> 4 & 0xF];
+	char text[64];
+	sprintf_s(text, "\x1b[38;2;%d;%d;%d;48;2;%d;%d;%dm", fore.r, fore.g, fore.b, back.r, back.g, back.b);
+	output += text;
+}
+
+bool Frame_Player::ExportAsciicast(const std::string& filePath)
+{
+	std::fstream cast;
+	cast.open(filePath, std::ios::out | std::ios::trunc);
+	if (!cast.is_open())
+		return false;
+
+	char text[128];
+	sprintf_s(text, "{\"version\": 2, \"width\": %d, \"height\": %d}\n", screenSize.i, screenSize.j);
+	cast << text;
+
+	Colour_Map colourMap;
+	int screenArea = screenSize.i * screenSize.j;
+	CHAR_INFO* shown = new CHAR_INFO[screenArea]();
+	std::string output;
+	std::string escaped;
+	while (NextFrame())
+	{
+		output.clear();
+		if (frameIndex == 1)
+			output += "\x1b[2J";
+
+		//Only changed cells are written, the cursor jump and colour are skipped when the last cell already left them right
+		int lastIndex = -2;
+		int lastAttributes = -1;
+		for (int i = 0; i < screenArea; i++)
+		{
+			if (frameIndex > 1 && shown[i].Char.UnicodeChar == frame[i].Char.UnicodeChar && shown[i].Attributes == frame[i].Attributes)
+				continue;
+
+			if (i != lastIndex + 1 || i % screenSize.i == 0)
+			{
+				sprintf_s(text, "\x1b[%d;%dH", i / screenSize.i + 1, i % screenSize.i + 1);
+				output += text;
+			}
+			if (frame[i].Attributes != lastAttributes)
+			{
+				AppendColours(output, colourMap, frame[i].Attributes);
+				lastAttributes = frame[i].Attributes;
+			}
+			AppendUtf8(output, frame[i].Char.UnicodeChar ? frame[i].Char.UnicodeChar : L' ');
+			lastIndex = i;
+		}
+		memcpy(shown, frame, sizeof(CHAR_INFO) * screenArea);
+
+		if (output.empty())
+			continue;
+
+		escaped.clear();
+		for (char c : output)
+		{
+			if (c == '"' || c == '\\')
+			{
+				escaped += '\\';
+				escaped += c;
+			}
+			else if ((unsigned char)c < 0x20)
+			{
+				sprintf_s(text, "\\u%04x", c);
+				escaped += text;
+			}
+			else
+				escaped += c;
+		}
+
+		sprintf_s(text, "[%.6f, \"o\", \"", timestamp);
+		cast << text << escaped << "\"]\n";
+	}
+
+	delete[] shown;
+	return true;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <fstream>
+#include <string>
+#include <vector>
+#include <Windows.h>
+#include "Math.h"
+
+class CGE;
+
+//Reads files written by Frame_Recorder
+class Frame_Player
+{
+public:
+	std::fstream file;
+	tVector2<int> screenSize;
+	CHAR_INFO* frame;
+	double timestamp;
+	long long frameIndex;
+	std::vector<unsigned char> payload;
+
+	Frame_Player();
+	~Frame_Player();
+
+	bool Open(const std::string& filePath);
+	void Close();
+
+	//Decodes the next frame into frame and timestamp, false at the end of the file or if it is corrupt
+	bool NextFrame();
+
+	//Presents every frame straight to the engine's console, at the recorded times or as fast as possible. Returns frames played
+	long long Play(CGE* engine, bool realTime = true);
+
+	//asciicast v2, one output event per frame carrying only the cells that changed
+	bool ExportAsciicast(const std::string& filePath);
+};
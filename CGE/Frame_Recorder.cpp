@@ -0,0 +1,151 @@
+#include <string.h>
+#include "Frame_Recorder.h"
+
+Frame_Recorder::Frame_Recorder()
+{
+	screenSize = { 0, 0 };
+	previous = nullptr;
+	framesRecorded = 0;
+	bytesWritten = 0;
+	encodeTime = 0;
+}
+
+Frame_Recorder::~Frame_Recorder()
+{
+	Stop();
+}
+
+bool Frame_Recorder::Start(const std::string& filePath, const tVector2<int>& screenSize)
+{
+	Stop();
+
+	file.open(filePath, std::ios::binary | std::ios::out | std::ios::trunc);
+	if (!file.is_open())
+		return false;
+
+	this->screenSize = screenSize;
+	int fileVersion = version;
+	file.write("CGER", 4);
+	file.write((const char*)&fileVersion, sizeof(int));
+	file.write((const char*)&screenSize.i, sizeof(int));
+	file.write((const char*)&screenSize.j, sizeof(int));
+
+	//The first frame is coded against a blank screen so it is just a keyframe
+	previous = new unsigned int[screenSize.i * screenSize.j]();
+	framesRecorded = 0;
+	bytesWritten = 16;
+	encodeTime = 0;
+	timer.reset();
+	return true;
+}
+
+void Frame_Recorder::Record(const CHAR_INFO* frame)
+{
+	if (!previous)
+		return;
+
+	double timestamp = timer.elapsed();
+	int screenArea = screenSize.i * screenSize.j;
+	const unsigned char* cells = (const unsigned char*)frame;
+	payload.clear();
+
+	int i = 0;
+	while (i < screenArea)
+	{
+		unsigned int value;
+		memcpy(&value, cells + i * 4, 4);
+		unsigned int delta = value ^ previous[i];
+
+		int run = 1;
+		unsigned int next;
+		while (i + run < screenArea)
+		{
+			memcpy(&next, cells + (i + run) * 4, 4);
+			if ((next ^ previous[i + run]) != delta)
+				break;
+			run++;
+		}
+
+		if (delta == 0)
+			WriteVarint(payload, run << 2 | Token_Skip);
+		else if (run > 2)
+		{
+			WriteVarint(payload, run << 2 | Token_Repeat);
+			payload.insert(payload.end(), (unsigned char*)&delta, (unsigned char*)&delta + 4);
+		}
+		else
+		{
+			//Gather changed cells until the next unchanged or repeating stretch
+			run = 0;
+			size_t header = payload.size();
+			payload.resize(header + 5);
+			while (i + run < screenArea)
+			{
+				memcpy(&value, cells + (i + run) * 4, 4);
+				delta = value ^ previous[i + run];
+				if (delta == 0)
+					break;
+				if (i + run + 2 < screenArea)
+				{
+					unsigned int a, b;
+					memcpy(&a, cells + (i + run + 1) * 4, 4);
+					memcpy(&b, cells + (i + run + 2) * 4, 4);
+					if (run > 0 && (a ^ previous[i + run + 1]) == delta && (b ^ previous[i + run + 2]) == delta)
+						break;
+				}
+				payload.insert(payload.end(), (unsigned char*)&delta, (unsigned char*)&delta + 4);
+				run++;
+			}
+
+			//Header was reserved at its largest, shift the literals down to fit the real varint
+			std::vector<unsigned char> token;
+			WriteVarint(token, run << 2 | Token_Literal);
+			payload.erase(payload.begin() + header + token.size(), payload.begin() + header + 5);
+			memcpy(payload.data() + header, token.data(), token.size());
+		}
+
+		i += run;
+	}
+
+	memcpy(previous, frame, screenArea * 4);
+
+	unsigned int payloadSize = (unsigned int)payload.size();
+	file.write((const char*)&timestamp, sizeof(double));
+	file.write((const char*)&payloadSize, sizeof(unsigned int));
+	file.write((const char*)payload.data(), payloadSize);
+
+	framesRecorded++;
+	bytesWritten += sizeof(double) + sizeof(unsigned int) + payloadSize;
+	encodeTime += timer.elapsed() - timestamp;
+}
+
+void Frame_Recorder::Stop()
+{
+	if (file.is_open())
+		file.close();
+	delete[] previous;
+	previous = nullptr;
+}
+
+void Frame_Recorder::WriteVarint(std::vector<unsigned char>& output, unsigned int value)
+{
+	while (value >= 0x80)
+	{
+		output.push_back((unsigned char)(value | 0x80));
+		value >>= 7;
+	}
+	output.push_back((unsigned char)value);
+}
+
+const unsigned char* Frame_Recorder::ReadVarint(const unsigned char* input, const unsigned char* end, unsigned int& value)
+{
+	value = 0;
+	for (int shift = 0; input < end && shift < 35; shift += 7)
+	{
+		unsigned char byte = *input++;
+		value |= (unsigned int)(byte & 0x7F) << shift;
+		if (!(byte & 0x80))
+			return input;
+	}
+	return nullptr;
+}
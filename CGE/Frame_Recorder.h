@@ -0,0 +1,39 @@
+#pragma once
+#include <fstream>
+#include <string>
+#include <vector>
+#include <Windows.h>
+#include "Math.h"
+#include "Timer.h"
+
+//File layout: "CGER", version, width, height, then per frame a timestamp in seconds, the payload size and the payload.
+//The payload is the frame XORed with the previous one as 32 bit cells, run length coded into tokens of
+//varint(count << 2 | kind) where kind 0 is unchanged cells, 1 is count copies of one value and 2 is count literal values
+class Frame_Recorder
+{
+public:
+	enum Token_Kind { Token_Skip = 0, Token_Repeat = 1, Token_Literal = 2 };
+	static const int version = 1;
+
+	std::fstream file;
+	tVector2<int> screenSize;
+	unsigned int* previous;
+	std::vector<unsigned char> payload;
+	Timer timer;
+
+	long long framesRecorded;
+	long long bytesWritten;
+	double encodeTime;
+
+	Frame_Recorder();
+	~Frame_Recorder();
+
+	bool Start(const std::string& filePath, const tVector2<int>& screenSize);
+	void Record(const CHAR_INFO* frame);
+	void Stop();
+
+	double BytesPerFrame() const { return framesRecorded ? (double)bytesWritten / framesRecorded : 0; }
+
+	static void WriteVarint(std::vector<unsigned char>& output, unsigned int value);
+	static const unsigned char* ReadVarint(const unsigned char* input, const unsigned char* end, unsigned int& value);
+};
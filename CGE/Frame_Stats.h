@@ -0,0 +1,51 @@
+#pragma once
+#include <atomic>
+
+struct Frame_Stats
+{
+	static const int maxStages = 16;
+
+	struct Stage
+	{
+		const char* name;
+		float p50, p95, p99;
+	};
+
+	float fps = 0;
+	float frameTime = 0;
+	float p50 = 0, p95 = 0, p99 = 0;
+	int stageCount = 0;
+	Stage stages[maxStages];
+};
+
+//One writer, any number of readers. A reader that overlaps a publish retries instead of blocking the writer.
+class Frame_Stats_Channel
+{
+public:
+	void Publish(const Frame_Stats& stats)
+	{
+		unsigned current = sequence.load(std::memory_order_relaxed);
+		sequence.store(current + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		this->stats = stats;
+		sequence.store(current + 2, std::memory_order_release);
+	}
+
+	Frame_Stats Read() const
+	{
+		Frame_Stats copy;
+		unsigned before, after;
+		do
+		{
+			before = sequence.load(std::memory_order_acquire);
+			copy = stats;
+			std::atomic_thread_fence(std::memory_order_acquire);
+			after = sequence.load(std::memory_order_relaxed);
+		} while (before != after || (before & 1));
+		return copy;
+	}
+
+private:
+	std::atomic<unsigned> sequence{ 0 };
+	Frame_Stats stats;
+};
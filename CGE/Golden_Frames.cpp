@@ -0,0 +1,433 @@
+#include <stdio.h>
+#include <fstream>
+#include <map>
+#include "Golden_Frames.h"
+#include "CGE.h"
+
+Golden_Frames::Golden_Frames(CGE* engine)
+{
+	this->engine = engine;
+	AddScenes();
+}
+
+static unsigned long long Hash(const void* data, size_t size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	unsigned long long hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+unsigned long long Golden_Frames::HashPixels() const
+{
+	return Hash(engine->screenBuffer.pixelBuffer, sizeof(Colour) * engine->screenSize.i * engine->screenSize.j);
+}
+
+unsigned long long Golden_Frames::HashChars() const
+{
+	return Hash(engine->screenBuffer.charBuffer, sizeof(CHAR_INFO) * engine->screenSize.i * engine->screenSize.j);
+}
+
+void Golden_Frames::AddScenes()
+{
+	//Every Draw* overload once, plus the edge cases a fast path is most likely to get wrong.
+	//Coordinates are fractions of the screen so the scenes fit any size, new scenes go on the end
+	auto at = [](CGE& e, float x, float y) { return Vector2{ e.screenSize.i * x, e.screenSize.j * y }; };
+
+	scenes.push_back({ "SetPixel", [=](CGE& e, const Colour& c)
+		{
+			for (int i = 0; i < 64; i++)
+				e.SetPixel(tVector2<int>{ i * 7 % e.screenSize.i, i * 13 % e.screenSize.j }, c);
+			e.SetPixel(tVector2<int>{ -1, 0 }, c);
+			e.SetPixel(tVector2<int>{ e.screenSize.i, e.screenSize.j }, c);
+			e.SetPixel(Point2D{ at(e, 0.5f, 0.5f), c });
+		} });
+	scenes.push_back({ "DrawLine", [=](CGE& e, const Colour& c)
+		{
+			e.DrawLine(tVector2<int>{ 2, 3 }, tVector2<int>{ e.screenSize.i - 5, e.screenSize.j - 2 }, c);
+			e.DrawLine(tVector2<int>{ 0, e.screenSize.j / 2 }, tVector2<int>{ e.screenSize.i - 1, e.screenSize.j / 2 }, c);
+			e.DrawLine(tVector2<int>{ e.screenSize.i / 3, 0 }, tVector2<int>{ e.screenSize.i / 3, e.screenSize.j - 1 }, c);
+			e.DrawLine(tVector2<int>{ 5, 5 }, tVector2<int>{ 5, 5 }, c);
+			e.DrawLine(tVector2<int>{ -40, -10 }, tVector2<int>{ e.screenSize.i + 40, e.screenSize.j + 25 }, c);
+			e.DrawLine(Line{ { at(e, 0.9f, 0.1f), at(e, 0.1f, 0.8f) } }, c);
+			e.DrawLine(tVector2<int>{ -100000, 7 }, tVector2<int>{ 100000, 9 }, c);
+		} });
+	scenes.push_back({ "DrawPolyline", [=](CGE& e, const Colour& c)
+		{
+			Vector2 points[6] = { at(e, 0.1f, 0.1f), at(e, 0.9f, 0.1f), at(e, 0.5f, 0.9f), at(e, 0.1f, 0.1f), at(e, -0.5f, 0.5f), at(e, 0.5f, 1.5f) };
+			e.DrawPolyline(points, 6, c);
+			e.DrawPolyline(points, 1, c);
+		} });
+	scenes.push_back({ "DrawLineEx", [=](CGE& e, const Colour& c)
+		{
+			e.DrawLineEx(at(e, 0.1f, 0.2f), at(e, 0.9f, 0.7f), c, 1);
+			e.DrawLineEx(at(e, 0.1f, 0.8f), at(e, 0.8f, 0.1f), c, 4);
+			e.DrawLineEx(at(e, -0.2f, 0.5f), at(e, 1.2f, 0.55f), c, 3);
+			e.DrawLineEx(Line{ { at(e, 0.5f, 0.1f), at(e, 0.5f, 0.9f) } }, c, 2);
+		} });
+	scenes.push_back({ "DrawPolylineEx", [=](CGE& e, const Colour& c)
+		{
+			Vector2 points[5] = { at(e, 0.05f, 0.1f), at(e, 0.3f, 0.9f), at(e, 0.35f, 0.2f), at(e, 0.6f, 0.5f), at(e, 0.1f, 0.5f) };
+			e.DrawPolylineEx(points, 5, 3, c, Join_Miter);
+			for (Vector2& point : points)
+				point.i += e.screenSize.i * 0.3f;
+			e.DrawPolylineEx(points, 5, 4, c, Join_Bevel);
+			for (Vector2& point : points)
+				point.j -= e.screenSize.j * 0.3f;
+			e.DrawPolylineEx(points, 5, 5, c, Join_Round);
+		} });
+	scenes.push_back({ "DrawEdge", [=](CGE& e, const Colour& c)
+		{
+			e.DrawEdge(Edge2D{ { { at(e, 0.1f, 0.1f), c }, { at(e, 0.9f, 0.9f), WHITE } } });
+			e.DrawEdgeEx(Edge2D{ { { at(e, 0.1f, 0.9f), c }, { at(e, 0.9f, 0.1f), WHITE } } }, 3);
+		} });
+	scenes.push_back({ "DrawCircle", [=](CGE& e, const Colour& c)
+		{
+			e.DrawCircle(at(e, 0.3f, 0.5f), e.screenSize.j * 0.3f, c);
+			e.DrawCircle(Circle{ at(e, 0.95f, 0.05f), e.screenSize.j * 0.25f }, c);
+			e.DrawCircle(at(e, 0.7f, 0.7f), 0.4f, c);
+		} });
+	scenes.push_back({ "DrawCircleLine", [=](CGE& e, const Colour& c)
+		{
+			e.DrawCircleLine(at(e, 0.3f, 0.5f), e.screenSize.j * 0.3f, c, 1);
+			e.DrawCircleLine(Circle{ at(e, 0.7f, 0.5f), e.screenSize.j * 0.25f }, c, 3);
+			e.DrawCircleLine(at(e, 0.0f, 1.0f), e.screenSize.j * 0.4f, c, 2);
+		} });
+	scenes.push_back({ "DrawOval", [=](CGE& e, const Colour& c)
+		{
+			e.DrawOval(at(e, 0.3f, 0.5f), at(e, 0.2f, 0.15f), 0.5f, c);
+			e.DrawOval(Oval{ at(e, 0.7f, 0.5f), at(e, 0.1f, 0.3f) }, 0, c);
+		} });
+	scenes.push_back({ "DrawOvalLine", [=](CGE& e, const Colour& c)
+		{
+			e.DrawOvalLine(at(e, 0.3f, 0.5f), at(e, 0.2f, 0.15f), 0, c, 1);
+			e.DrawOvalLine(Oval{ at(e, 0.7f, 0.5f), at(e, 0.1f, 0.3f) }, 0.7f, c, 2);
+			e.DrawOvalLine(at(e, 1.0f, 0.0f), at(e, 0.3f, 0.2f), 1.2f, c, 1);
+		} });
+	scenes.push_back({ "DrawRect", [=](CGE& e, const Colour& c)
+		{
+			e.DrawRect(at(e, 0.25f, 0.5f), at(e, 0.3f, 0.4f), 0, c);
+			e.DrawRect(Rect{ at(e, 0.7f, 0.5f), at(e, 0.25f, 0.3f) }, 0.6f, c);
+			e.DrawRect(at(e, 0.5f, 0.0f), at(e, 1.5f, 0.2f), 0.1f, c);
+			e.DrawRect(at(e, 0.5f, 0.5f), { 0, 0 }, 0, c);
+		} });
+	scenes.push_back({ "DrawRectLine", [=](CGE& e, const Colour& c)
+		{
+			e.DrawRectLine(at(e, 0.25f, 0.5f), at(e, 0.3f, 0.4f), 0, c, 1);
+			e.DrawRectLine(Rect{ at(e, 0.7f, 0.5f), at(e, 0.25f, 0.3f) }, 0.6f, c, 3);
+		} });
+	scenes.push_back({ "DrawRectangle", [=](CGE& e, const Colour& c)
+		{
+			e.DrawRectangle(Rectangle2D{ Rect{ at(e, 0.5f, 0.5f), at(e, 0.5f, 0.5f) }, { c, RED, GREEN, BLUE } }, 0.2f);
+			e.DrawRectangleLine(Triangle{ at(e, 0.5f, 0.5f), { at(e, -0.2f, -0.2f), at(e, 0.2f, -0.2f), at(e, 0.2f, 0.2f) } }, 0, 1, c);
+		} });
+	scenes.push_back({ "DrawTriangle", [=](CGE& e, const Colour& c)
+		{
+			e.DrawTriangle(at(e, 0.1f, 0.1f), at(e, 0.5f, 0.9f), at(e, 0.9f, 0.2f), c);
+			e.DrawTriangle(at(e, 0.1f, 0.9f), at(e, 0.9f, 0.9f), at(e, 0.5f, 0.1f), { 40, 200, 255, c.a });
+			e.DrawTriangle(Triangle{ at(e, 0.5f, 0.5f), { at(e, 0, 0.3f), at(e, -0.25f, -0.2f), at(e, 0.25f, -0.2f) } }, 0.4f, c);
+			e.DrawTriangle(Triangle2D{ at(e, 0.5f, 0.5f), { { at(e, 0, 0.3f), c }, { at(e, -0.25f, -0.2f), RED }, { at(e, 0.25f, -0.2f), BLUE } } }, 0);
+		} });
+	scenes.push_back({ "DrawTriangleEdgeCases", [=](CGE& e, const Colour& c)
+		{
+			//Degenerate, clockwise, sub-pixel and entirely off screen
+			e.DrawTriangle(at(e, 0.1f, 0.1f), at(e, 0.5f, 0.5f), at(e, 0.9f, 0.9f), c);
+			e.DrawTriangle(at(e, 0.2f, 0.2f), at(e, 0.2f, 0.2f), at(e, 0.2f, 0.2f), c);
+			e.DrawTriangle(at(e, 0.9f, 0.2f), at(e, 0.5f, 0.9f), at(e, 0.1f, 0.1f), c);
+			e.DrawTriangle(at(e, 0.5f, 0.5f), { e.screenSize.i * 0.5f + 0.3f, e.screenSize.j * 0.5f }, { e.screenSize.i * 0.5f, e.screenSize.j * 0.5f + 0.3f }, c);
+			e.DrawTriangle(at(e, -1.0f, -1.0f), at(e, -0.5f, -1.0f), at(e, -0.7f, -0.2f), c);
+			e.DrawTriangle(at(e, 1.5f, 0.5f), at(e, 2.0f, 0.6f), at(e, 1.7f, 0.9f), c);
+			e.DrawTriangle(at(e, -2.0f, -2.0f), at(e, 3.0f, -2.0f), at(e, 0.5f, 3.0f), { c.r, c.g, c.b, (unsigned char)(c.a / 4) });
+		} });
+	scenes.push_back({ "DrawTriangleDepth", [=](CGE& e, const Colour& c)
+		{
+			e.DrawTriangle(Vector3{ e.screenSize.i * 0.1f, e.screenSize.j * 0.1f, 0.5f }, Vector3{ e.screenSize.i * 0.9f, e.screenSize.j * 0.2f, 0.5f }, Vector3{ e.screenSize.i * 0.5f, e.screenSize.j * 0.9f, 0.5f }, c);
+			e.DrawTriangle(Vector3{ e.screenSize.i * 0.0f, e.screenSize.j * 0.5f, 0.2f }, Vector3{ e.screenSize.i * 1.0f, e.screenSize.j * 0.4f, 0.8f }, Vector3{ e.screenSize.i * 0.5f, e.screenSize.j * 0.6f, 0.5f }, RED);
+			e.DrawTriangle(Vector3{ e.screenSize.i * 0.2f, e.screenSize.j * 0.2f, 0.9f }, Vector3{ e.screenSize.i * 0.8f, e.screenSize.j * 0.2f, 0.9f }, Vector3{ e.screenSize.i * 0.5f, e.screenSize.j * 0.8f, 0.9f }, GREEN);
+		} });
+	scenes.push_back({ "DrawTriangleLine", [=](CGE& e, const Colour& c)
+		{
+			e.DrawTriangleLine(Triangle{ at(e, 0.5f, 0.5f), { at(e, 0, 0.3f), at(e, -0.25f, -0.2f), at(e, 0.25f, -0.2f) } }, 0, c, 1);
+			e.DrawTriangleLine(Triangle{ at(e, 0.5f, 0.5f), { at(e, 0, 0.4f), at(e, -0.4f, -0.3f), at(e, 0.4f, -0.3f) } }, 1.0f, c, 2);
+		} });
+	scenes.push_back({ "DrawTexture", [=](CGE& e, const Colour& c)
+		{
+			Texture texture;
+			texture.textureWidth = 8;
+			texture.textureHeight = 8;
+			texture.data = new Colour[64];
+			for (int i = 0; i < 64; i++)
+				texture.data[i] = ((i % 8 + i / 8) & 1) ? c : WHITE;
+
+			Triangle source = { { 4, 4 }, { { -4, -4 }, { 4, -4 }, { 4, 4 } } };
+			Triangle dest = { at(e, 0.5f, 0.5f), { at(e, -0.3f, -0.3f), at(e, 0.3f, -0.3f), at(e, 0.3f, 0.3f) } };
+			vTriangle2D mapped = { at(e, 0.5f, 0.5f), { { at(e, -0.3f, -0.3f), { 0, 0 } }, { at(e, 0.3f, -0.3f), { 1, 0 } }, { at(e, 0.3f, 0.3f), { 1, 1 } } } };
+			e.DrawTriangleTexture(source, dest, texture, 0, 0.3f);
+			e.DrawTriangleTexture(mapped, texture, 0);
+			e.DrawRectangleTexture(source, dest, texture, 0, 0.3f);
+			e.DrawRectangleTexture(mapped, texture, 0);
+		} });
+	scenes.push_back({ "DrawPoly", [=](CGE& e, const Colour& c)
+		{
+			Poly<5> pentagon(at(e, 0.3f, 0.5f));
+			Poly<8> octagon(at(e, 0.7f, 0.5f), 0.2f);
+			Shape<6> hexagon(at(e, 0.5f, 0.5f));
+			vShape<4> square(at(e, 0.5f, 0.5f));
+			for (int i = 0; i < 6; i++)
+				hexagon.point[i].colour = i & 1 ? c : YELLOW;
+			e.DrawPoly(pentagon, 0, c);
+			e.DrawPolyLine(octagon, 0.5f, c, 2);
+			e.DrawShape(hexagon, 0.1f);
+
+			Texture texture;
+			texture.textureWidth = 2;
+			texture.textureHeight = 2;
+			texture.data = new Colour[4]{ c, WHITE, WHITE, c };
+			e.DrawShapeTexture(Poly<4>(Vector2{ 1, 1 }), Poly<4>(at(e, 0.5f, 0.5f)), texture);
+			e.DrawShapeTexture(square, texture, 0.3f);
+		} });
+	scenes.push_back({ "DrawText", [=](CGE& e, const Colour& c)
+		{
+			e.DrawText("GOLDEN 0123", { 1, e.screenSize.j - 9 }, c, 1);
+			e.DrawText("Ag", { 1, 1 }, c, 2);
+			e.DrawText("clipped off the right edge", { e.screenSize.i - 20, e.screenSize.j / 2 }, c, 1);
+			e.DrawTextNative("native", { 2, e.screenSize.j / 3 }, c, BLUE);
+		} });
+	scenes.push_back({ "ClipViewport", [=](CGE& e, const Colour& c)
+		{
+			//Same drawing in two half screen viewports, the right one with a nested clip
+			int half = e.screenSize.i / 2;
+			for (int side = 0; side < 2; side++)
+			{
+				e.SetViewport(side * half, 0, half, e.screenSize.j);
+				if (side)
+				{
+					e.PushClip(4, 4, half - 8, e.screenSize.j - 8);
+					e.PushClip(half / 2, 0, half, e.screenSize.j / 2);
+				}
+				e.DrawCircle({ half * 0.5f, e.screenSize.j * 0.5f }, e.screenSize.j * 0.4f, c);
+				e.DrawLine(tVector2<int>{ -10, -10 }, tVector2<int>{ half + 10, e.screenSize.j + 10 }, YELLOW);
+				e.DrawRect({ half * 0.5f, 4.0f }, { (float)half, 6.0f }, 0, BLUE);
+				e.DrawText("VP", { 2, e.screenSize.j - 2 }, WHITE);
+			}
+			e.PopClip();
+			e.PopClip();
+			e.ResetViewport();
+		} });
+	scenes.push_back({ "PartialRedraw", [=](CGE& e, const Colour& c)
+		{
+			//Moves the circle in a retained frame, only the rectangles it left and entered are redrawn
+			int w = e.screenSize.i, h = e.screenSize.j;
+			float x = w * 0.3f, radius = h * 0.2f;
+			auto frame = [&]()
+			{
+				e.SetBuffer(DARK_GREY);
+				e.DrawTriangle({ 0, 0 }, { (float)w, h * 0.5f }, { w * 0.2f, (float)h }, BLUE);
+				e.DrawCircle({ x, h * 0.5f }, radius, c);
+				e.DrawText("RETAINED", { 2, h - 2 }, WHITE);
+			};
+
+			e.SetRetainedMode(true);
+			e.ResetBuffer();
+			e.Redraw(frame);
+			int r = (int)radius + 1;
+			e.Invalidate((int)x - r, h / 2 - r, r * 2 + 1, r * 2 + 1);
+			x = w * 0.7f;
+			e.Invalidate((int)x - r, h / 2 - r, r * 2 + 1, r * 2 + 1);
+			e.ResetBuffer();
+			e.Redraw(frame);
+			e.SetRetainedMode(false);
+		} });
+	scenes.push_back({ "PartialRedrawPresentThread", [=](CGE& e, const Colour& c)
+		{
+			//The same retained frames presented on the thread, the buffer handed back has to hold the previous frame
+			int w = e.screenSize.i, h = e.screenSize.j;
+			float x = w * 0.3f, radius = h * 0.2f;
+			auto frame = [&]()
+			{
+				e.SetBuffer(DARK_GREY);
+				e.DrawTriangle({ 0, 0 }, { (float)w, h * 0.5f }, { w * 0.2f, (float)h }, BLUE);
+				e.DrawCircle({ x, h * 0.5f }, radius, c);
+				e.DrawText("RETAINED", { 2, h - 2 }, WHITE);
+			};
+
+			e.SetPresentThread(true);
+			e.SetRetainedMode(true);
+			for (int i = 0; i < 3; i++)
+			{
+				int r = (int)radius + 1;
+				e.Invalidate((int)x - r, h / 2 - r, r * 2 + 1, r * 2 + 1);
+				x = w * (0.3f + 0.2f * i);
+				e.Invalidate((int)x - r, h / 2 - r, r * 2 + 1, r * 2 + 1);
+				e.ResetBuffer();
+				e.Redraw(frame);
+				e.DrawBuffer();
+			}
+			e.SetRetainedMode(false);
+			e.SetPresentThread(false);
+		} });
+	scenes.push_back({ "DrawLineAA", [=](CGE& e, const Colour& c)
+		{
+			//Shallow, steep, axis aligned, sub-pixel and clipped, coverage changes show up in the blended pixels
+			e.DrawLineAA(at(e, 0.05f, 0.1f), at(e, 0.95f, 0.35f), c);
+			e.DrawLineAA(at(e, 0.2f, 0.05f), at(e, 0.3f, 0.95f), c);
+			e.DrawLineAA(at(e, 0.1f, 0.5f), at(e, 0.9f, 0.5f), c);
+			e.DrawLineAA(at(e, 0.6f, 0.1f), at(e, 0.6f, 0.9f), c);
+			e.DrawLineAA(at(e, 0.5f, 0.5f), { e.screenSize.i * 0.5f + 0.4f, e.screenSize.j * 0.5f + 0.2f }, c);
+			e.DrawLineAA(at(e, -0.3f, 0.9f), at(e, 1.3f, 0.6f), c);
+			e.DrawLineAA(at(e, 0.9f, -0.2f), at(e, 0.7f, 1.2f), c);
+		} });
+	scenes.push_back({ "DrawCircleAA", [=](CGE& e, const Colour& c)
+		{
+			e.DrawCircleAA(at(e, 0.3f, 0.5f), e.screenSize.j * 0.3f, c);
+			e.DrawCircleAA({ e.screenSize.i * 0.7f + 0.5f, e.screenSize.j * 0.6f }, e.screenSize.j * 0.15f + 0.4f, c);
+			e.DrawCircleAA(at(e, 0.8f, 0.2f), 1.5f, c);
+			e.DrawCircleAA(at(e, 0.95f, 0.05f), e.screenSize.j * 0.25f, c);
+		} });
+	scenes.push_back({ "Composite", [=](CGE& e, const Colour& c)
+		{
+			//An opaque and a translucent layer, updated from inside a game viewport and clip which have to survive it
+			int w = e.screenSize.i, h = e.screenSize.j;
+			Render_Target solid({ w / 2, h / 2 });
+			Render_Target glass({ w / 2, h / 2 });
+
+			e.SetBuffer(DARK_GREY);
+			e.SetViewport(w / 8, h / 8, w * 3 / 4, h * 3 / 4);
+			e.PushClip(0, 0, w * 5 / 8, h * 5 / 8);
+			e.UpdateLayer(solid, [&]()
+				{
+					e.SetBuffer(BLUE);
+					e.DrawCircle({ w * 0.25f, h * 0.25f }, h * 0.2f, c);
+				});
+			e.UpdateLayer(glass, [&]()
+				{
+					e.DrawTriangle({ 0, 0 }, { w * 0.5f, 0 }, { w * 0.25f, h * 0.5f }, c);
+					e.DrawRect({ w * 0.25f, h * 0.25f }, { w * 0.2f, h * 0.1f }, 0, { 40, 200, 255, 128 });
+				});
+
+			e.Composite(solid, -w / 16, -h / 16, Composite_Copy);
+			e.Composite(glass, w / 4, 0, Composite_Alpha);
+			e.Composite(glass, 0, h / 4, Composite_Alpha, 100);
+			e.Composite(solid, w / 3, h / 3, Composite_Add, 180);
+			e.PopClip();
+			e.ResetViewport();
+		} });
+}
+
+void Golden_Frames::Render(const Scene& scene, const Colour& colour)
+{
+	engine->ResetBuffer();
+	scene.draw(*engine, colour);
+}
+
+static const char* variants[2] = { "opaque", "translucent" };
+static const Colour variantColours[2] = { Colour(255, 140, 20), Colour(255, 140, 20, 128) };
+
+bool Golden_Frames::Update(const std::string& directory)
+{
+	std::fstream goldenFile;
+	goldenFile.open(directory + "/golden.txt", std::ios::out | std::ios::trunc);
+	if (!goldenFile.is_open())
+		return false;
+
+	char line[256];
+	for (const Scene& scene : scenes)
+	{
+		for (int variant = 0; variant < 2; variant++)
+		{
+			std::string name = scene.name + "_" + variants[variant];
+			Render(scene, variantColours[variant]);
+
+			sprintf_s(line, "%s %016llx %016llx\n", name.c_str(), HashPixels(), HashChars());
+			goldenFile << line;
+
+			if (!Image::SaveImageFile(directory + "/" + name + ".bmp", engine->screenBuffer.pixelBuffer, engine->screenSize.i, engine->screenSize.j))
+				return false;
+		}
+	}
+
+	printf("Golden frames: wrote %d frames to %s\n", (int)scenes.size() * 2, directory.c_str());
+	return true;
+}
+
+int Golden_Frames::Check(const std::string& directory)
+{
+	std::fstream goldenFile;
+	goldenFile.open(directory + "/golden.txt", std::ios::in);
+	if (!goldenFile.is_open())
+		return -1;
+
+	std::map<std::string, std::pair<unsigned long long, unsigned long long>> goldens;
+	std::string line;
+	char name[128];
+	unsigned long long pixelHash, charHash;
+	while (std::getline(goldenFile, line))
+		if (sscanf_s(line.c_str(), "%127s %llx %llx", name, (unsigned)sizeof(name), &pixelHash, &charHash) == 3)
+			goldens[name] = { pixelHash, charHash };
+
+	int failures = 0;
+	for (const Scene& scene : scenes)
+	{
+		for (int variant = 0; variant < 2; variant++)
+		{
+			std::string frame = scene.name + "_" + variants[variant];
+			Render(scene, variantColours[variant]);
+
+			auto golden = goldens.find(frame);
+			if (golden == goldens.end())
+			{
+				printf("  %-32s MISSING\n", frame.c_str());
+				failures++;
+				continue;
+			}
+
+			bool pixelsMatch = golden->second.first == HashPixels();
+			bool charsMatch = golden->second.second == HashChars();
+			if (pixelsMatch && charsMatch)
+				continue;
+
+			//Pixels can match while characters differ when only the colour quantisation changed
+			printf("  %-32s FAIL %s%s\n", frame.c_str(), pixelsMatch ? "" : "pixels ", charsMatch ? "" : "chars");
+			WriteDiff(directory, frame);
+			failures++;
+		}
+	}
+
+	printf("Golden frames: %d of %d failed\n", failures, (int)scenes.size() * 2);
+	return failures;
+}
+
+bool Golden_Frames::WriteDiff(const std::string& directory, const std::string& name) const
+{
+	int width = engine->screenSize.i;
+	int height = engine->screenSize.j;
+	const Colour* actual = engine->screenBuffer.pixelBuffer;
+	Image::SaveImageFile(directory + "/" + name + "_actual.bmp", actual, width, height);
+
+	Texture reference;
+	if (!reference.LoadTexture(directory + "/" + name + ".bmp") || reference.textureWidth != width || reference.textureHeight != height)
+		return false;
+
+	//Matching pixels are dimmed greyscale, differing ones are solid red
+	Colour* diff = new Colour[width * height];
+	for (int i = 0; i < width * height; i++)
+	{
+		const Colour& a = actual[i];
+		const Colour& b = reference.data[i];
+		if (a.r != b.r || a.g != b.g || a.b != b.b || a.a != b.a)
+			diff[i] = RED;
+		else
+		{
+			int grey = (a.r + a.g + a.b) / 12;
+			diff[i] = Colour(grey, grey, grey);
+		}
+	}
+
+	bool written = Image::SaveImageFile(directory + "/" + name + "_diff.bmp", diff, width, height);
+	delete[] diff;
+	return written;
+}
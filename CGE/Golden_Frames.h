@@ -0,0 +1,39 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <vector>
+
+class CGE;
+class Colour;
+
+class Golden_Frames
+{
+public:
+	struct Scene
+	{
+		std::string name;
+		std::function<void(CGE&, const Colour&)> draw;
+	};
+
+	CGE* engine;
+	std::vector<Scene> scenes;
+
+	//The engine should be 3D so depth tested scenes have a depth buffer to use
+	Golden_Frames(CGE* engine);
+
+	//Renders every scene opaque and translucent and checks the hashes against directory/golden.txt,
+	//mismatches write name_actual.bmp and name_diff.bmp next to the reference. Returns the number of failures, -1 if there are no goldens
+	int Check(const std::string& directory);
+
+	//Overwrites golden.txt and the reference bitmaps with the current output
+	bool Update(const std::string& directory);
+
+	//FNV-1a over pixelBuffer and charBuffer
+	unsigned long long HashPixels() const;
+	unsigned long long HashChars() const;
+
+private:
+	void AddScenes();
+	void Render(const Scene& scene, const Colour& colour);
+	bool WriteDiff(const std::string& directory, const std::string& name) const;
+};
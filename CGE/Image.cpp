@@ -1 +1,121 @@
+#include <fstream>
+#include <string.h>
 #include "Image.h"
+#include "Colour.h"
+
+Image::Image()
+{
+	size = 0;
+	header = nullptr;
+	headerSize = 0;
+	data = nullptr;
+	dataSize = 0;
+	width = 0;
+	height = 0;
+	bitsPerPixel = 0;
+	topDown = false;
+}
+
+Image::~Image()
+{
+	delete[] header;
+	delete[] data;
+}
+
+bool Image::LoadImageFile(const std::string& filePath)
+{
+	//Uncompressed 24 and 32 bit bitmaps only
+	std::fstream imageFile;
+	imageFile.open(filePath, std::ios::binary | std::ios::in);
+	if (!imageFile.is_open())
+		return false;
+
+	imageFile.seekg(0, std::ios::end);
+	size = (int)imageFile.tellg();
+	imageFile.seekg(0, std::ios::beg);
+	if (size < 54)
+		return false;
+
+	char fileHeader[54];
+	imageFile.read(fileHeader, 54);
+	if (fileHeader[0] != 'B' || fileHeader[1] != 'M')
+		return false;
+
+	int dataOffset, compression;
+	short bits;
+	memcpy(&dataOffset, fileHeader + 10, sizeof(int));
+	memcpy(&width, fileHeader + 18, sizeof(int));
+	memcpy(&height, fileHeader + 22, sizeof(int));
+	memcpy(&bits, fileHeader + 28, sizeof(short));
+	memcpy(&compression, fileHeader + 30, sizeof(int));
+	bitsPerPixel = bits;
+
+	if ((bitsPerPixel != 24 && bitsPerPixel != 32) || (compression != 0 && compression != 3))
+		return false;
+	if (width <= 0 || height == 0 || dataOffset < 54 || dataOffset > size)
+		return false;
+
+	topDown = height < 0;
+	if (topDown)
+		height = -height;
+
+	int stride = (width * bitsPerPixel / 8 + 3) & ~3;
+	if ((long long)stride * height > size - dataOffset)
+		return false;
+
+	delete[] header;
+	delete[] data;
+	headerSize = dataOffset;
+	header = new char[headerSize];
+	dataSize = stride * height;
+	data = new char[dataSize];
+
+	imageFile.seekg(0, std::ios::beg);
+	imageFile.read(header, headerSize);
+	imageFile.read(data, dataSize);
+
+	return !imageFile.fail();
+}
+
+bool Image::SaveImageFile(const std::string& filePath, const Colour* pixels, int width, int height)
+{
+	std::fstream imageFile;
+	imageFile.open(filePath, std::ios::binary | std::ios::out | std::ios::trunc);
+	if (!imageFile.is_open())
+		return false;
+
+	int dataSize = width * height * 4;
+	int fileSize = 54 + dataSize;
+	int dataOffset = 54;
+	int infoSize = 40;
+	short planes = 1;
+	short bits = 32;
+
+	char fileHeader[54] = { 'B', 'M' };
+	memcpy(fileHeader + 2, &fileSize, sizeof(int));
+	memcpy(fileHeader + 10, &dataOffset, sizeof(int));
+	memcpy(fileHeader + 14, &infoSize, sizeof(int));
+	memcpy(fileHeader + 18, &width, sizeof(int));
+	memcpy(fileHeader + 22, &height, sizeof(int));
+	memcpy(fileHeader + 26, &planes, sizeof(short));
+	memcpy(fileHeader + 28, &bits, sizeof(short));
+	memcpy(fileHeader + 34, &dataSize, sizeof(int));
+	imageFile.write(fileHeader, 54);
+
+	char* row = new char[width * 4];
+	for (int h = 0; h < height; h++)
+	{
+		for (int w = 0; w < width; w++)
+		{
+			const Colour& pixel = pixels[width * h + w];
+			row[w * 4 + 0] = pixel.b;
+			row[w * 4 + 1] = pixel.g;
+			row[w * 4 + 2] = pixel.r;
+			row[w * 4 + 3] = pixel.a;
+		}
+		imageFile.write(row, width * 4);
+	}
+	delete[] row;
+
+	return !imageFile.fail();
+}
@@ -1,6 +1,8 @@
 #pragma once
 #include <string>
 
+class Colour;
+
 class Image
 {
 public:
@@ -10,9 +12,17 @@ public:
 	char* data;
 	int dataSize;
 
+	int width;
+	int height;
+	int bitsPerPixel;
+	bool topDown;
+
 	Image();
 	~Image();
 
 	bool LoadImageFile(const std::string& filePath);
+
+	//Writes rows bottom up as a 32 bit bitmap, the same layout LoadImageFile and Texture read back
+	static bool SaveImageFile(const std::string& filePath, const Colour* pixels, int width, int height);
 };
 
@@ -0,0 +1,208 @@
+#include <Windows.h>
+#include "Job_System.h"
+
+//Index of the queue owned by the current worker thread, -1 on threads the system didn't start
+static thread_local int workerIndex = -1;
+static thread_local Job_System* workerSystem = nullptr;
+
+Job_System::Job_System(int workers, bool pinThreads)
+{
+	if (workers < 0)
+	{
+		int hardware = (int)std::thread::hardware_concurrency();
+		workers = hardware > 1 ? hardware - 1 : 1;
+	}
+
+	//One queue per worker plus one shared by every outside thread
+	for (int i = 0; i <= workers; i++)
+		queues.emplace_back(new Queue());
+
+	nextQueue.store(0);
+	queuedJobs.store(0);
+	active.store(true);
+
+	for (int i = 0; i < workers; i++)
+	{
+		this->workers.emplace_back([this, i]() { WorkerLoop(i); });
+		if (pinThreads)
+			SetThreadAffinityMask(this->workers.back().native_handle(), 1ull << ((i + 1) % 64));
+	}
+}
+
+Job_System::~Job_System()
+{
+	{
+		std::lock_guard<std::mutex> guard(idleLock);
+		active.store(false);
+	}
+	idle.notify_all();
+	for (std::thread& worker : workers)
+		worker.join();
+
+	//Nothing submitted is dropped, finish whatever is left on this thread
+	while (RunOne((int)workers.size(), true)) { }
+}
+
+Job_System::Job_Handle Job_System::Create(const std::function<void()>& work)
+{
+	Job_Handle job = std::make_shared<Job>();
+	job->work = work;
+	job->pending.store(1);
+	job->finished.store(false);
+	return job;
+}
+
+void Job_System::Depend(const Job_Handle& job, const Job_Handle& dependency)
+{
+	std::lock_guard<std::mutex> guard(dependency->lock);
+	if (dependency->finished.load())
+		return;
+
+	job->pending++;
+	dependency->continuations.push_back(job);
+}
+
+void Job_System::Submit(const Job_Handle& job)
+{
+	if (--job->pending == 0)
+		Enqueue(job);
+}
+
+void Job_System::SubmitBackground(const Job_Handle& job)
+{
+	job->background = true;
+	Submit(job);
+}
+
+void Job_System::Wait(const Job_Handle& job)
+{
+	//Help out instead of blocking so waiting from inside a job can't deadlock the pool.
+	//Background jobs are left alone, a decode picked up here would stall whoever is waiting for its own short jobs
+	int home = workerSystem == this ? workerIndex : (int)workers.size();
+	while (!job->finished.load(std::memory_order_acquire))
+	{
+		if (!RunOne(home, false))
+			std::this_thread::yield();
+	}
+}
+
+bool Job_System::RunPending()
+{
+	return RunOne(workerSystem == this ? workerIndex : (int)workers.size(), true);
+}
+
+void Job_System::ParallelFor(int begin, int end, int grain, const std::function<void(int, int)>& body)
+{
+	if (end <= begin)
+		return;
+	if (grain < 1)
+		grain = 1;
+
+	Job_Handle done = Create([]() { });
+	for (int first = begin; first < end; first += grain)
+	{
+		int last = first + grain < end ? first + grain : end;
+		Job_Handle chunk = Create([&body, first, last]() { body(first, last); });
+		Depend(done, chunk);
+		Submit(chunk);
+	}
+	Submit(done);
+	Wait(done);
+}
+
+void Job_System::Enqueue(const Job_Handle& job)
+{
+	int home = workerSystem == this ? workerIndex : (int)workers.size();
+	Queue& queue = job->background ? backgroundQueue : *queues[home];
+	{
+		std::lock_guard<std::mutex> guard(queue.lock);
+		queue.jobs.push_back(job);
+	}
+	queuedJobs++;
+
+	{
+		std::lock_guard<std::mutex> guard(idleLock);
+	}
+	idle.notify_one();
+}
+
+bool Job_System::RunOne(int home, bool background)
+{
+	Job_Handle job;
+
+	//Newest job from our own queue first, it is most likely still in cache
+	{
+		std::lock_guard<std::mutex> guard(queues[home]->lock);
+		if (!queues[home]->jobs.empty())
+		{
+			job = queues[home]->jobs.back();
+			queues[home]->jobs.pop_back();
+			queuedJobs--;
+		}
+	}
+
+	//Otherwise steal the oldest job from someone else
+	if (!job)
+	{
+		int count = (int)queues.size();
+		int start = (int)(nextQueue++ % count);
+		for (int i = 0; i < count && !job; i++)
+		{
+			Queue& victim = *queues[(start + i) % count];
+			std::lock_guard<std::mutex> guard(victim.lock);
+			if (!victim.jobs.empty())
+			{
+				job = victim.jobs.front();
+				victim.jobs.pop_front();
+				queuedJobs--;
+			}
+		}
+	}
+
+	//Background jobs only once nothing else is queued, oldest first
+	if (!job && background)
+	{
+		std::lock_guard<std::mutex> guard(backgroundQueue.lock);
+		if (!backgroundQueue.jobs.empty())
+		{
+			job = backgroundQueue.jobs.front();
+			backgroundQueue.jobs.pop_front();
+			queuedJobs--;
+		}
+	}
+
+	if (!job)
+		return false;
+
+	job->work();
+	Finish(job);
+	return true;
+}
+
+void Job_System::Finish(const Job_Handle& job)
+{
+	std::vector<Job_Handle> continuations;
+	{
+		std::lock_guard<std::mutex> guard(job->lock);
+		job->finished.store(true, std::memory_order_release);
+		continuations.swap(job->continuations);
+	}
+
+	for (const Job_Handle& continuation : continuations)
+		Submit(continuation);
+}
+
+void Job_System::WorkerLoop(int index)
+{
+	workerIndex = index;
+	workerSystem = this;
+
+	while (active.load())
+	{
+		if (RunOne(index, true))
+			continue;
+
+		std::unique_lock<std::mutex> guard(idleLock);
+		idle.wait(guard, [this]() { return !active.load() || queuedJobs.load() > 0; });
+	}
+}
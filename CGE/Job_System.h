@@ -0,0 +1,65 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class Job_System
+{
+public:
+	struct Job
+	{
+		std::function<void()> work;
+		std::atomic<int> pending;
+		std::atomic<bool> finished;
+		std::mutex lock;
+		std::vector<std::shared_ptr<Job>> continuations;
+		//Background jobs are only picked up by workers and RunPending, never by a thread waiting in Wait
+		bool background = false;
+	};
+	typedef std::shared_ptr<Job> Job_Handle;
+
+	//workers < 0 uses one worker per hardware thread besides the calling thread
+	Job_System(int workers = -1, bool pinThreads = false);
+	~Job_System();
+
+	Job_Handle Create(const std::function<void()>& work);
+	void Depend(const Job_Handle& job, const Job_Handle& dependency);
+	void Submit(const Job_Handle& job);
+	//For long jobs off the frame's critical path, such as asset decodes
+	void SubmitBackground(const Job_Handle& job);
+	void Wait(const Job_Handle& job);
+
+	//Splits [begin, end) into chunks of at most grain and runs body(first, last) on each, returns once all are done
+	void ParallelFor(int begin, int end, int grain, const std::function<void(int, int)>& body);
+
+	//Runs one queued job on the calling thread if there is one, background jobs included
+	bool RunPending();
+
+	int WorkerCount() const { return (int)workers.size(); }
+
+private:
+	struct Queue
+	{
+		std::mutex lock;
+		std::deque<Job_Handle> jobs;
+	};
+
+	void Enqueue(const Job_Handle& job);
+	bool RunOne(int home, bool background);
+	void Finish(const Job_Handle& job);
+	void WorkerLoop(int index);
+
+	std::vector<std::thread> workers;
+	std::vector<std::unique_ptr<Queue>> queues;
+	Queue backgroundQueue;
+	std::atomic<unsigned> nextQueue;
+	std::atomic<int> queuedJobs;
+	std::atomic<bool> active;
+	std::mutex idleLock;
+	std::condition_variable idle;
+};
@@ -1,7 +1,76 @@
+#include <stdlib.h>
+#include <string.h>
 #include "CGE.h"
+#include "Benchmark.h"
+#include "Golden_Frames.h"
+#include "Frame_Player.h"
 
-void main()
+void main(int argc, char** argv)
 {
+	//CGE -compare baseline.json current.json [threshold], exits with 1 if anything regressed
+	if (argc > 3 && strcmp(argv[1], "-compare") == 0)
+	{
+		int regressions = Benchmark::Compare(argv[2], argv[3], argc > 4 ? (float)atof(argv[4]) : 0.1f);
+		exit(regressions != 0);
+	}
+
+	//CGE -play recording.cger [-fast] replays a recording, -asciicast recording.cger output.cast converts one
+	if (argc > 2 && (strcmp(argv[1], "-play") == 0 || strcmp(argv[1], "-asciicast") == 0))
+	{
+		Frame_Player player;
+		if (!player.Open(argv[2]))
+			exit(1);
+		if (strcmp(argv[1], "-asciicast") == 0)
+			exit(argc < 4 || !player.ExportAsciicast(argv[3]));
+
+		CGE engine(L"playback", { 4, 4 }, player.screenSize);
+		player.Play(&engine, !(argc > 3 && strcmp(argv[3], "-fast") == 0));
+		return;
+	}
+
+	//CGE -golden-update [directory] writes the goldens. Checking against them with Golden_Frames::Check is wired up
+	//as -golden once a set generated by the MSVC build is checked in, until then it could only ever fail
+	if (argc > 1 && strcmp(argv[1], "-golden-update") == 0)
+	{
+		CGE engine(L"golden", { 4, 4 }, { 96, 64 }, true);
+		Golden_Frames golden(&engine);
+		exit(!golden.Update(argc > 2 ? argv[2] : "Golden"));
+	}
+
+	//CGE -benchmark [results.json] [-present], headless unless -present so sizes don't depend on the console.
+	//The present thread case only measures anything with a console
+	if (argc > 1 && strcmp(argv[1], "-benchmark") == 0)
+	{
+		std::vector<Benchmark::Result> results;
+		{
+			bool present = argc > 3 && strcmp(argv[3], "-present") == 0;
+			CGE engine(L"benchmark", { 4, 4 }, { 200, 200 }, true, present ? Present_Console : Present_Headless);
+			Benchmark benchmark(&engine);
+			benchmark.HierarchicalDepth();
+			benchmark.PresentThread();
+			benchmark.JobScaling();
+		}
+
+		tVector2<int> sizes[] = { { 80, 50 }, { 160, 100 }, { 320, 200 } };
+		for (const tVector2<int>& size : sizes)
+		{
+			CGE engine(L"benchmark", { 2, 2 }, size, false, Present_Headless);
+			Benchmark benchmark(&engine);
+			benchmark.Primitives();
+			benchmark.AntiAliasing();
+			benchmark.Layers();
+			benchmark.PartialRedraw();
+			benchmark.OutputModes();
+			benchmark.TerminalEncoding();
+			results.insert(results.end(), benchmark.results.begin(), benchmark.results.end());
+		}
+
+		Benchmark output(nullptr);
+		output.results = results;
+		output.WriteResults(argc > 2 ? argv[2] : "benchmark.json");
+		return;
+	}
+
 	CGE game(L"test", { 4, 4 }, { 200, 200 });
 	game.StartTimer();
 	float f = 0;
@@ -23,4 +92,4 @@ void main()
 		game.DrawBuffer();
 		game.UpdateTimer();
 	}
-}
\ No newline at end of file
+}
@@ -0,0 +1,126 @@
+#include <math.h>
+#include "Path.h"
+
+void Path::Clear()
+{
+	points.clear();
+	contourEnds.clear();
+}
+
+void Path::AddContour(const Vector2* contour, int count, bool counterClockwise)
+{
+	if (count < 3)
+		return;
+
+	float area = 0;
+	for (int i = 0, j = count - 1; i < count; j = i++)
+		area += contour[j].i * contour[i].j - contour[i].i * contour[j].j;
+	if (area == 0)
+		return;
+
+	if ((area > 0) == counterClockwise)
+		points.insert(points.end(), contour, contour + count);
+	else
+		for (int i = count - 1; i >= 0; i--)
+			points.push_back(contour[i]);
+	contourEnds.push_back((int)points.size());
+}
+
+void Path::Stroke(const Vector2* polyline, size_t count, float thickness, Line_Join join, float miterLimit)
+{
+	if (thickness <= 0)
+		return;
+
+	//Repeated points have no direction to offset along
+	std::vector<Vector2> line;
+	line.reserve(count);
+	for (size_t i = 0; i < count; i++)
+		if (line.empty() || line.back().i != polyline[i].i || line.back().j != polyline[i].j)
+			line.push_back(polyline[i]);
+	if (line.size() < 2)
+		return;
+
+	float half = thickness * 0.5f;
+	int segments = (int)line.size() - 1;
+	std::vector<Vector2> normals(segments);
+	for (int i = 0; i < segments; i++)
+	{
+		float dx = line[i + 1].i - line[i].i;
+		float dy = line[i + 1].j - line[i].j;
+		float length = sqrtf(dx * dx + dy * dy);
+		normals[i] = { -dy / length, dx / length };
+
+		Vector2 quad[4] =
+		{
+			{ line[i].i + normals[i].i * half, line[i].j + normals[i].j * half },
+			{ line[i].i - normals[i].i * half, line[i].j - normals[i].j * half },
+			{ line[i + 1].i - normals[i].i * half, line[i + 1].j - normals[i].j * half },
+			{ line[i + 1].i + normals[i].i * half, line[i + 1].j + normals[i].j * half }
+		};
+		AddContour(quad, 4);
+	}
+
+	for (int i = 1; i < segments; i++)
+	{
+		Vector2 point = line[i];
+		Vector2 n0 = normals[i - 1];
+		Vector2 n1 = normals[i];
+
+		//Normals turn the same way as the line, the gap to fill opens on the side away from the turn
+		float cross = n0.i * n1.j - n0.j * n1.i;
+		float dot = n0.i * n1.i + n0.j * n1.j;
+		if (dot > 0.9999f)
+			continue;
+		if (cross > 0)
+		{
+			n0 = { -n0.i, -n0.j };
+			n1 = { -n1.i, -n1.j };
+		}
+		Vector2 outer0 = { point.i + n0.i * half, point.j + n0.j * half };
+		Vector2 outer1 = { point.i + n1.i * half, point.j + n1.j * half };
+
+		if (join == Join_Round)
+		{
+			//Enough steps to keep the chord within a quarter pixel of the arc
+			float angle = acosf(dot < -1 ? -1 : dot);
+			float step = half > 0.25f ? 2 * acosf(1 - 0.25f / half) : angle;
+			int steps = (int)ceilf(angle / step);
+			if (steps < 1)
+				steps = 1;
+
+			float direction = n0.i * n1.j - n0.j * n1.i < 0 ? -1.0f : 1.0f;
+			std::vector<Vector2> fan;
+			fan.reserve(steps + 2);
+			fan.push_back(point);
+			for (int k = 0; k <= steps; k++)
+			{
+				float a = direction * angle * k / steps;
+				float c = cosf(a), s = sinf(a);
+				fan.push_back({ point.i + (n0.i * c - n0.j * s) * half, point.j + (n0.i * s + n0.j * c) * half });
+			}
+			AddContour(fan.data(), (int)fan.size());
+			continue;
+		}
+
+		if (join == Join_Miter)
+		{
+			float mx = n0.i + n1.i, my = n0.j + n1.j;
+			float length = sqrtf(mx * mx + my * my);
+			if (length > 0.0001f)
+			{
+				mx /= length;
+				my /= length;
+				float reach = 1 / (mx * n0.i + my * n0.j);
+				if (reach <= miterLimit)
+				{
+					Vector2 miter[4] = { point, outer0, { point.i + mx * reach * half, point.j + my * reach * half }, outer1 };
+					AddContour(miter, 4);
+					continue;
+				}
+			}
+		}
+
+		Vector2 bevel[3] = { point, outer0, outer1 };
+		AddContour(bevel, 3);
+	}
+}
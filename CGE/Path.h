@@ -0,0 +1,33 @@
+#pragma once
+#include <vector>
+#include "Math.h"
+
+enum Fill_Rule
+{
+	Fill_NonZero,
+	Fill_EvenOdd
+};
+
+enum Line_Join
+{
+	Join_Miter,
+	Join_Bevel,
+	Join_Round
+};
+
+//A set of closed contours filled together, contourEnds holds one past the last point of each contour
+class Path
+{
+public:
+	std::vector<Vector2> points;
+	std::vector<int> contourEnds;
+
+	void Clear();
+
+	//Counter-clockwise contours only add to the winding number, so overlapping pieces still fill once
+	void AddContour(const Vector2* contour, int count, bool counterClockwise = true);
+
+	//Outline of a polyline thickness wide with butt ends, built from a quad per segment and a piece per join.
+	//Miters longer than miterLimit half widths fall back to bevels
+	void Stroke(const Vector2* polyline, size_t count, float thickness, Line_Join join = Join_Miter, float miterLimit = 4);
+};
@@ -115,6 +115,20 @@ struct vRectangle3D
 	Vector2 texel[4];
 };
 
+//Calls f(0) to f(s - 1) as straight line code, for loops over the fixed sides of Poly and Shape
+template <int i, int s>
+struct Unroll
+{
+	template <class F>
+	static void Run(F& f) { f(i); Unroll<i + 1, s>::Run(f); }
+};
+template <int s>
+struct Unroll<s, s>
+{
+	template <class F>
+	static void Run(F&) { }
+};
+
 template <int s>
 class Poly
 {
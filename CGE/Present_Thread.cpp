@@ -0,0 +1,76 @@
+#include "Present_Thread.h"
+#include "Profiler.h"
+
+Present_Thread::Present_Thread(HANDLE output, const tVector2<int>& screenSize, const SMALL_RECT& windowArea, CHAR_INFO* charBuffer)
+{
+	this->output = output;
+	this->screenSize = screenSize;
+	this->windowArea = windowArea;
+
+	int screenArea = screenSize.i * screenSize.j;
+	slots[0] = { charBuffer, 0 };
+	slots[1] = { new CHAR_INFO[screenArea], 0 };
+	slots[2] = { new CHAR_INFO[screenArea], 0 };
+	ZeroMemory(slots[1].buffer, sizeof(CHAR_INFO) * screenArea);
+	ZeroMemory(slots[2].buffer, sizeof(CHAR_INFO) * screenArea);
+	back = 0;
+	ready.store(1);
+	front = 2;
+
+	framesPresented.store(0);
+	framesDropped.store(0);
+	totalLatency.store(0);
+
+	wake = CreateEventW(NULL, FALSE, FALSE, NULL);
+	active.store(true);
+	worker = std::thread([this]() { Run(); });
+}
+
+Present_Thread::~Present_Thread()
+{
+	active.store(false);
+	SetEvent(wake);
+	worker.join();
+	CloseHandle(wake);
+
+	//The game thread still holds slots[back], which its Screen_Buffer deletes
+	for (int i = 0; i < 3; i++)
+		if (i != back) delete[] slots[i].buffer;
+}
+
+CHAR_INFO* Present_Thread::Submit(CHAR_INFO* frame)
+{
+	slots[back].buffer = frame;
+	slots[back].submitted = Profiler::Now();
+
+	//A frame still marked fresh was never presented, it is replaced rather than queued
+	int previous = ready.exchange(back | fresh, std::memory_order_acq_rel);
+	if (previous & fresh)
+		framesDropped++;
+
+	back = previous & 3;
+	SetEvent(wake);
+	return slots[back].buffer;
+}
+
+void Present_Thread::Run()
+{
+	while (active.load())
+	{
+		if (!(ready.load(std::memory_order_acquire) & fresh))
+		{
+			WaitForSingleObject(wake, INFINITE);
+			continue;
+		}
+
+		front = ready.exchange(front, std::memory_order_acq_rel) & 3;
+
+		{
+			PROFILE_ZONE("Present");
+			WriteConsoleOutput(output, slots[front].buffer, { (short)screenSize.i, (short)screenSize.j }, { 0, 0 }, &windowArea);
+		}
+
+		totalLatency += Profiler::Now() - slots[front].submitted;
+		framesPresented++;
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <Windows.h>
+#include <atomic>
+#include <thread>
+#include "Math.h"
+
+//Presents finished char buffers on its own thread. The game thread, the present thread and the latest
+//finished frame each own one of three buffers and trade them through a single atomic index.
+class Present_Thread
+{
+public:
+	Present_Thread(HANDLE output, const tVector2<int>& screenSize, const SMALL_RECT& windowArea, CHAR_INFO* charBuffer);
+	~Present_Thread();
+
+	//Hands over a finished frame and returns the buffer to draw the next one into
+	CHAR_INFO* Submit(CHAR_INFO* frame);
+
+	std::atomic<long long> framesPresented;
+	std::atomic<long long> framesDropped;
+	std::atomic<long long> totalLatency;
+
+private:
+	void Run();
+
+	struct Slot
+	{
+		CHAR_INFO* buffer;
+		long long submitted;
+	};
+
+	static const int fresh = 4;
+
+	HANDLE output;
+	tVector2<int> screenSize;
+	SMALL_RECT windowArea;
+
+	Slot slots[3];
+	std::atomic<int> ready;
+	int back;
+	int front;
+
+	HANDLE wake;
+	std::atomic<bool> active;
+	std::thread worker;
+};
@@ -0,0 +1,183 @@
+#include <chrono>
+#include <mutex>
+#include <algorithm>
+#include <fstream>
+#include <string.h>
+#include "Profiler.h"
+
+//Rings outlive their threads so their events still show up, a new thread takes over a retired ring before allocating one
+static struct Ring_Registry
+{
+	std::mutex lock;
+	std::vector<Profiler::Ring*> rings;
+	std::vector<Profiler::Ring*> retired;
+	int nextThread = 0;
+
+	~Ring_Registry()
+	{
+		for (Profiler::Ring* ring : rings)
+			delete ring;
+	}
+} registry;
+
+struct Ring_Owner
+{
+	Profiler::Ring* ring = nullptr;
+
+	~Ring_Owner()
+	{
+		if (!ring)
+			return;
+		std::lock_guard<std::mutex> lock(registry.lock);
+		registry.retired.push_back(ring);
+	}
+};
+
+long long Profiler::Now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Profiler::Ring* Profiler::ThreadRing()
+{
+	//Registration takes the lock once per thread, recording never does
+	thread_local Ring_Owner owner;
+	if (!owner.ring)
+	{
+		std::lock_guard<std::mutex> lock(registry.lock);
+		if (!registry.retired.empty())
+		{
+			owner.ring = registry.retired.back();
+			registry.retired.pop_back();
+			owner.ring->thread = registry.nextThread++;
+		}
+		else
+		{
+			owner.ring = new Ring();
+			owner.ring->head.store(0, std::memory_order_relaxed);
+			owner.ring->tail.store(0, std::memory_order_relaxed);
+			owner.ring->thread = registry.nextThread++;
+			registry.rings.push_back(owner.ring);
+		}
+	}
+	return owner.ring;
+}
+
+void Profiler::Record(const char* name, long long start, long long end)
+{
+	Ring* ring = ThreadRing();
+	unsigned head = ring->head.load(std::memory_order_relaxed);
+	Event& event = ring->events[head % Ring::capacity];
+	event.name = name;
+	event.start = start;
+	event.duration = end - start;
+	event.thread = ring->thread;
+	ring->head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::Snapshot(std::vector<Event>& events)
+{
+	std::lock_guard<std::mutex> lock(registry.lock);
+	for (Ring* ring : registry.rings)
+	{
+		unsigned head = ring->head.load(std::memory_order_acquire);
+		unsigned count = head - ring->tail.load(std::memory_order_relaxed);
+		if (count > Ring::capacity) count = Ring::capacity;
+		size_t first = events.size();
+		for (unsigned i = head - count; i != head; i++)
+			events.push_back(ring->events[i % Ring::capacity]);
+
+		//The owner kept recording while this copied, anything it could have reached since may be torn.
+		//Writing event head overwrites the slot of head - capacity, so only later events are safe
+		std::atomic_thread_fence(std::memory_order_acquire);
+		unsigned overtaken = ring->head.load(std::memory_order_relaxed) - (head - count);
+		overtaken = overtaken >= Ring::capacity ? overtaken - Ring::capacity + 1 : 0;
+		if (overtaken > count) overtaken = count;
+		events.erase(events.begin() + first, events.begin() + first + overtaken);
+	}
+}
+
+std::vector<Profiler::Stage> Profiler::Stages()
+{
+	std::vector<Event> events;
+	Snapshot(events);
+
+	//Group by zone name, names are string literals so compare the text not the pointer
+	std::sort(events.begin(), events.end(), [](const Event& lhs, const Event& rhs)
+		{
+			int order = strcmp(lhs.name, rhs.name);
+			return order ? order < 0 : lhs.duration < rhs.duration;
+		});
+
+	std::vector<Stage> stages;
+	size_t first = 0;
+	while (first < events.size())
+	{
+		size_t last = first;
+		while (last < events.size() && strcmp(events[last].name, events[first].name) == 0)
+			last++;
+
+		size_t count = last - first;
+		Stage stage;
+		stage.name = events[first].name;
+		stage.count = (int)count;
+		stage.p50 = events[first + count * 50 / 100].duration * 0.000001f;
+		stage.p95 = events[first + count * 95 / 100].duration * 0.000001f;
+		stage.p99 = events[first + count * 99 / 100].duration * 0.000001f;
+		stages.push_back(stage);
+		first = last;
+	}
+
+	return stages;
+}
+
+bool Profiler::GetStage(const char* name, Stage& stage)
+{
+	for (const Stage& current : Stages())
+	{
+		if (strcmp(current.name, name) == 0)
+		{
+			stage = current;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool Profiler::WriteTrace(const std::string& filePath)
+{
+	std::fstream traceFile;
+	traceFile.open(filePath, std::ios::out | std::ios::trunc);
+	if (!traceFile.is_open())
+		return false;
+
+	std::vector<Event> events;
+	Snapshot(events);
+
+	long long origin = events.empty() ? 0 : events[0].start;
+	for (const Event& event : events)
+		if (event.start < origin) origin = event.start;
+
+	//Chrome trace_event format, complete events with microsecond timestamps
+	char line[256];
+	traceFile << "{\"traceEvents\":[\n";
+	for (size_t i = 0; i < events.size(); i++)
+	{
+		const Event& event = events[i];
+		snprintf(line, sizeof(line), "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}%s\n",
+			event.name, event.thread, (event.start - origin) * 0.001, event.duration * 0.001,
+			i + 1 < events.size() ? "," : "");
+		traceFile << line;
+	}
+	traceFile << "],\"displayTimeUnit\":\"ns\"}\n";
+
+	return true;
+}
+
+void Profiler::Clear()
+{
+	std::lock_guard<std::mutex> lock(registry.lock);
+	for (Ring* ring : registry.rings)
+		ring->tail.store(ring->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+}
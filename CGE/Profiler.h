@@ -0,0 +1,65 @@
+#pragma once
+#include <atomic>
+#include <string>
+#include <vector>
+
+//Define CGE_PROFILE to compile the timing zones in, otherwise PROFILE_ZONE expands to nothing.
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#if defined(CGE_PROFILE)
+#define PROFILE_ZONE(name) Profile_Zone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#else
+#define PROFILE_ZONE(name)
+#endif
+
+class Profiler
+{
+public:
+	struct Event
+	{
+		const char* name;
+		long long start;
+		long long duration;
+		int thread;
+	};
+
+	//head is written only by the owning thread, tail only by Clear. thread is the current owner's id,
+	//each event keeps the id it was recorded under so a reclaimed ring doesn't relabel the dead thread's events
+	struct Ring
+	{
+		static const unsigned capacity = 1 << 14;
+		Event events[capacity];
+		std::atomic<unsigned> head;
+		std::atomic<unsigned> tail;
+		int thread;
+	};
+
+	struct Stage
+	{
+		const char* name;
+		int count;
+		float p50, p95, p99;
+	};
+
+	static long long Now();
+	static void Record(const char* name, long long start, long long end);
+
+	static std::vector<Stage> Stages();
+	static bool GetStage(const char* name, Stage& stage);
+	static bool WriteTrace(const std::string& filePath);
+	static void Clear();
+
+private:
+	static Ring* ThreadRing();
+	static void Snapshot(std::vector<Event>& events);
+};
+
+class Profile_Zone
+{
+public:
+	const char* name;
+	long long start;
+
+	Profile_Zone(const char* name) : name(name), start(Profiler::Now()) { }
+	~Profile_Zone() { Profiler::Record(name, start, Profiler::Now()); }
+};
@@ -0,0 +1,63 @@
+#include "Render_Target.h"
+#include "Colour.h"
+#include "Texture.h"
+
+Render_Target::Render_Target(const tVector2<int>& size)
+{
+	this->size = size;
+	buffer.InitialiseBuffer(size);
+	invalid = true;
+	opaque = false;
+	ownsPixels = true;
+	Clear();
+}
+
+Render_Target::Render_Target(Texture& texture)
+{
+	size = { texture.textureWidth, texture.textureHeight };
+	buffer.InitialiseBuffer(size);
+
+	//Textures are stored bottom row first like pixelBuffer, so they can be drawn into directly
+	delete[] buffer.pixelBuffer;
+	buffer.pixelBuffer = texture.data;
+	ownsPixels = false;
+	invalid = true;
+
+	int area = size.i * size.j;
+	buffer.ResetCharBuffer(area);
+	buffer.ResetEdgeBuffer(size.j);
+	buffer.ResetDepthBuffer(area);
+	buffer.ResetOverdrawBuffer(area);
+	UpdateOpacity();
+}
+
+Render_Target::~Render_Target()
+{
+	if (!ownsPixels)
+		buffer.pixelBuffer = nullptr;
+}
+
+void Render_Target::Invalidate()
+{
+	invalid = true;
+}
+
+void Render_Target::Clear()
+{
+	int area = size.i * size.j;
+	buffer.SetPixelBuffer(area, Colour(0, 0, 0, 0));
+	buffer.ResetCharBuffer(area);
+	buffer.ResetEdgeBuffer(size.j);
+	buffer.ResetDepthBuffer(area);
+	buffer.ResetOverdrawBuffer(area);
+	opaque = false;
+}
+
+bool Render_Target::UpdateOpacity()
+{
+	int area = size.i * size.j;
+	opaque = true;
+	for (int i = 0; i < area && opaque; i++)
+		opaque = buffer.pixelBuffer[i].a == 255;
+	return opaque;
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "Math.h"
+#include "Screen_Buffer.h"
+
+class Texture;
+
+enum Composite_Mode
+{
+	Composite_Copy,
+	Composite_Alpha,
+	Composite_Add
+};
+
+//Offscreen buffers a draw call can be pointed at with CGE::SetRenderTarget, then composited onto the screen as a layer.
+//While a target is bound its buffers live in CGE::screenBuffer, so it must be unbound before it is cleared or destroyed
+class Render_Target
+{
+public:
+	tVector2<int> size;
+	Screen_Buffer buffer;
+	//CGE::UpdateLayer only redraws targets that have been invalidated
+	bool invalid;
+	//Every pixel has full alpha, so alpha compositing can copy whole rows
+	bool opaque;
+	//False when drawing into a texture, its characters are then worked out from the pixels when composited
+	bool ownsPixels;
+
+	Render_Target(const tVector2<int>& size);
+	//Draws straight into the texture's pixels, the texture has to outlive the target and keep its size
+	Render_Target(Texture& texture);
+	~Render_Target();
+
+	void Invalidate();
+	//Fully transparent pixels, empty characters and far depth
+	void Clear();
+	bool UpdateOpacity();
+};
@@ -1,5 +1,6 @@
 #include "Screen_Buffer.h"
 #include "Colour.h"
+#include <utility>
 
 Screen_Buffer::Screen_Buffer()
 {
@@ -11,7 +12,7 @@ Screen_Buffer::~Screen_Buffer()
 	delete[] charBuffer;
 	delete[] pixelBuffer;
 	delete[] edgeBuffer;
-	delete[] depthBuffer;
+	delete[] overdrawBuffer;
 }
 
 void Screen_Buffer::InitialiseBuffer(const tVector2<int>& screenSize)
@@ -19,8 +20,32 @@ void Screen_Buffer::InitialiseBuffer(const tVector2<int>& screenSize)
 	int screenArea = screenSize.i * screenSize.j;
 	charBuffer = new CHAR_INFO[screenArea];
 	pixelBuffer = new Colour[screenArea];
-	edgeBuffer = new int[screenSize.j];
-	depthBuffer = new float[screenArea];
+	edgeBuffer = new int[screenSize.j * 2];
+	depthBuffer.Initialise(screenSize);
+	overdrawBuffer = new unsigned char[screenArea];
+	ResetOverdrawBuffer(screenArea);
+}
+
+void Screen_Buffer::ReleaseBuffer()
+{
+	delete[] charBuffer;
+	delete[] pixelBuffer;
+	delete[] edgeBuffer;
+	delete[] overdrawBuffer;
+	charBuffer = nullptr;
+	pixelBuffer = nullptr;
+	edgeBuffer = nullptr;
+	overdrawBuffer = nullptr;
+	depthBuffer.Release();
+}
+
+void Screen_Buffer::Swap(Screen_Buffer& other)
+{
+	std::swap(charBuffer, other.charBuffer);
+	std::swap(pixelBuffer, other.pixelBuffer);
+	std::swap(edgeBuffer, other.edgeBuffer);
+	std::swap(overdrawBuffer, other.overdrawBuffer);
+	depthBuffer.Swap(other.depthBuffer);
 }
 
 void Screen_Buffer::ResetCharBuffer(int screenArea)
@@ -37,12 +62,17 @@ void Screen_Buffer::ResetPixelBuffer(int screenArea)
 
 void Screen_Buffer::ResetEdgeBuffer(int screenHeight)
 {
-	ZeroMemory(edgeBuffer, sizeof(float) * screenHeight);
+	ZeroMemory(edgeBuffer, sizeof(int) * screenHeight * 2);
 }
 
 void Screen_Buffer::ResetDepthBuffer(int screenArea)
 {
-	ZeroMemory(depthBuffer, sizeof(float) * screenArea);
+	depthBuffer.Reset(screenArea);
+}
+
+void Screen_Buffer::ResetOverdrawBuffer(int screenArea)
+{
+	ZeroMemory(overdrawBuffer, sizeof(unsigned char) * screenArea);
 }
 
 void Screen_Buffer::SetCharBuffer(int screenArea, CHAR_INFO pixel)
@@ -59,14 +89,24 @@ void Screen_Buffer::SetPixelBuffer(int screenArea, Colour colour)
 
 void Screen_Buffer::SetEdgeBuffer(int screenHeight, int column)
 {
-	for (int i = 0; i < screenHeight; i++)
+	for (int i = 0; i < screenHeight * 2; i++)
 		memcpy(edgeBuffer + i, &column, sizeof(int));
 }
 
 void Screen_Buffer::SetDepthBuffer(int screenArea, float depth)
 {
-	for (int i = 0; i < screenArea; i++)
-		memcpy(depthBuffer + i, &depth, sizeof(float));
+	depthBuffer.Set(screenArea, Depth_Buffer::Encode(depth));
+}
+
+void Screen_Buffer::ResetRows(const tVector2<int>& screenSize, int first, int last)
+{
+	int offset = screenSize.i * first;
+	int rowsArea = screenSize.i * (last - first);
+
+	ZeroMemory(charBuffer + offset, sizeof(CHAR_INFO) * rowsArea);
+	Colour colour;
+	for (int i = offset; i < offset + rowsArea; i++)
+		memcpy(pixelBuffer + i, &colour, sizeof(Colour));
 }
 
 void Screen_Buffer::ResetBuffer2D(const tVector2<int>& screenSize)
@@ -86,4 +126,18 @@ void Screen_Buffer::ResetBuffer3D(const tVector2<int>& screenSize)
 	ResetPixelBuffer(screenArea);
 	ResetEdgeBuffer(screenSize.j);
 	ResetDepthBuffer(screenArea);
+}
+
+void Screen_Buffer::ResetRect(const tVector2<int>& screenSize, int left, int bottom, int right, int top, bool depth)
+{
+	Colour colour;
+	for (int h = bottom; h < top; h++)
+	{
+		ZeroMemory(charBuffer + screenSize.i * (screenSize.j - h - 1) + left, sizeof(CHAR_INFO) * (right - left));
+		Colour* pixels = pixelBuffer + screenSize.i * h;
+		for (int w = left; w < right; w++)
+			memcpy(pixels + w, &colour, sizeof(Colour));
+	}
+	if (depth)
+		depthBuffer.ResetRect(screenSize, left, bottom, right, top);
 }
\ No newline at end of file
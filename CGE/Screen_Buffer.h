@@ -1,6 +1,7 @@
 #pragma once
 #include <windows.h>
 #include "Math.h"
+#include "Depth_Buffer.h"
 
 class Colour;
 
@@ -11,23 +12,33 @@ public:
 	~Screen_Buffer();
 
 	void InitialiseBuffer(const tVector2<int>& screenSize);
+	//Frees every buffer so InitialiseBuffer can be called again with a new size
+	void ReleaseBuffer();
+	//Exchanges every buffer with other, used to bind render targets without copying
+	void Swap(Screen_Buffer& other);
 
 	void ResetCharBuffer(int screenArea);
 	void ResetPixelBuffer(int screenArea);
 	void ResetEdgeBuffer(int screenHeight);
 	void ResetDepthBuffer(int screenArea);
+	void ResetOverdrawBuffer(int screenArea);
 
 	void SetCharBuffer(int screenArea, CHAR_INFO pixel);
 	void SetPixelBuffer(int screenArea, Colour colour);
 	void SetEdgeBuffer(int screenHeight, int column);
 	void SetDepthBuffer(int screenArea, float depth);
 
+	void ResetRows(const tVector2<int>& screenSize, int first, int last);
 	void ResetBuffer2D(const tVector2<int>& screenSize);
 	void ResetBuffer3D(const tVector2<int>& screenSize);
+	//Clears columns left to right and rows bottom to top, both exclusive, for retained frames
+	void ResetRect(const tVector2<int>& screenSize, int left, int bottom, int right, int top, bool depth);
 
 	CHAR_INFO* charBuffer;
 	Colour* pixelBuffer;
+	//Left and right pixel of the span on each row, filled edge by edge when scan converting convex polygons
 	int* edgeBuffer;
-	float* depthBuffer;
+	Depth_Buffer depthBuffer;
+	unsigned char* overdrawBuffer;
 };
 
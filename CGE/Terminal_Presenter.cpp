@@ -0,0 +1,496 @@
+#include <climits>
+#include "Terminal_Presenter.h"
+#include "Profiler.h"
+
+Terminal_Presenter::Terminal_Presenter(HANDLE output, const tVector2<int>& consoleSize, Present_Mode mode, const Cell_Quantizer& quantizer)
+{
+	this->output = output;
+	this->consoleSize = consoleSize;
+	this->mode = mode;
+	quadrantGlyphs = quantizer.quadrantGlyphs;
+	brailleGlyphs = quantizer.brailleGlyphs;
+
+	int consoleArea = consoleSize.i * consoleSize.j;
+	cells = new Cell[consoleArea];
+	previous = new Cell[consoleArea];
+	//Truecolor uses the palette too, an exact match is shorter as an index
+	BuildXtermPalette();
+	repeatSupported = true;
+	framesPresented = 0;
+	bytesWritten = 0;
+	encodeTime = 0;
+	Invalidate();
+
+	//No output only encodes, for measuring
+	if (!output)
+		return;
+
+	//Glyphs are written as UTF-8 and the console has to parse the sequences instead of printing them
+	DWORD consoleMode = 0;
+	GetConsoleMode(output, &consoleMode);
+	SetConsoleMode(output, consoleMode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+	SetConsoleOutputCP(CP_UTF8);
+
+	const char* hideCursor = "\x1b[?25l";
+	DWORD written = 0;
+	WriteFile(output, hideCursor, 6, &written, NULL);
+}
+
+Terminal_Presenter::~Terminal_Presenter()
+{
+	//Leave the terminal with its default colours and a visible cursor
+	const char* restore = "\x1b[0m\x1b[?25h";
+	DWORD written = 0;
+	if (output)
+		WriteFile(output, restore, 10, &written, NULL);
+
+	delete[] cells;
+	delete[] previous;
+	delete[] xtermIndex;
+}
+
+void Terminal_Presenter::Present(const Colour* pixels, const tVector2<int>& screenSize, Output_Mode outputMode)
+{
+	Resolve(pixels, screenSize, outputMode);
+
+	timer.reset();
+	Encode();
+	encodeTime += timer.elapsed();
+
+	DWORD written = 0;
+	if (output && !frame.empty())
+		WriteFile(output, frame.data(), (DWORD)frame.size(), &written, NULL);
+	bytesWritten += frame.size();
+	framesPresented++;
+}
+
+void Terminal_Presenter::Resolve(const Colour* pixels, const tVector2<int>& screenSize, Output_Mode outputMode)
+{
+	PROFILE_ZONE("Resolve");
+	tVector2<int> cellSize = Cell_Quantizer::CellSize(outputMode);
+	const wchar_t* glyphs = outputMode == Output_Braille ? brailleGlyphs : quadrantGlyphs;
+
+	for (int row = 0; row < consoleSize.j; row++)
+	{
+		Cell* rowCells = cells + consoleSize.i * row;
+		const Colour* top = pixels + screenSize.i * (screenSize.j - 1 - row * cellSize.j);
+		for (int column = 0; column < consoleSize.i; column++)
+		{
+			Cell& cell = rowCells[column];
+			if (outputMode == Output_Shade)
+			{
+				cell.glyph = L' ';
+				cell.back = cell.fore = top[column];
+			}
+			else if (outputMode == Output_HalfBlock)
+			{
+				cell.glyph = L'\x2580';
+				cell.fore = top[column];
+				cell.back = top[column - screenSize.i];
+			}
+			else
+			{
+				//Splits the cell around its two most different pixels, each side shows the mean of its pixels
+				Colour block[8];
+				int count = cellSize.i * cellSize.j;
+				const Colour* source = top + column * cellSize.i;
+				for (int h = 0; h < cellSize.j; h++, source -= screenSize.i)
+					for (int w = 0; w < cellSize.i; w++)
+						block[h * cellSize.i + w] = source[w];
+
+				int seedFore = 0, seedBack = 0, spread = 0;
+				for (int i = 0; i < count; i++)
+					for (int j = i + 1; j < count; j++)
+						if (Cell_Quantizer::Distance(block[i], block[j]) > spread)
+						{
+							spread = Cell_Quantizer::Distance(block[i], block[j]);
+							seedFore = i;
+							seedBack = j;
+						}
+
+				int pattern = 0, sum[2][4] = { };
+				for (int i = 0; i < count; i++)
+				{
+					int side = Cell_Quantizer::Distance(block[i], block[seedFore]) < Cell_Quantizer::Distance(block[i], block[seedBack]) ? 0 : 1;
+					pattern |= (side == 0) << i;
+					sum[side][0] += block[i].r;
+					sum[side][1] += block[i].g;
+					sum[side][2] += block[i].b;
+					sum[side][3]++;
+				}
+
+				cell.glyph = glyphs[pattern];
+				for (int side = 0; side < 2; side++)
+				{
+					Colour& mean = side ? cell.back : cell.fore;
+					int n = sum[side][3] ? sum[side][3] : 1;
+					mean = Colour(sum[side][0] / n, sum[side][1] / n, sum[side][2] / n);
+				}
+				if (!sum[1][3])
+					cell.back = cell.fore;
+			}
+
+			cell.fore.a = 255;
+			cell.back.a = 255;
+			if (mode == Present_Xterm256)
+			{
+				cell.foreIndex = (unsigned char)XtermIndex(cell.fore);
+				cell.backIndex = (unsigned char)XtermIndex(cell.back);
+				cell.fore = xtermColours[cell.foreIndex];
+				cell.back = xtermColours[cell.backIndex];
+			}
+			//A glyph drawn in its background colour is just a space, which doesn't need the foreground set
+			if (cell.fore == cell.back)
+				cell.glyph = L' ';
+		}
+	}
+}
+
+static int Digits(int value)
+{
+	int digits = 1;
+	for (; value >= 10; value /= 10)
+		digits++;
+	return digits;
+}
+
+static int GlyphBytes(wchar_t glyph)
+{
+	return glyph < 0x80 ? 1 : glyph < 0x800 ? 2 : 3;
+}
+
+void Terminal_Presenter::Encode()
+{
+	PROFILE_ZONE("Encode");
+	frame.clear();
+
+	for (int row = 0; row < consoleSize.j; row++)
+	{
+		const Cell* rowCells = cells + consoleSize.i * row;
+		const Cell* rowPrevious = previous + consoleSize.i * row;
+		int column = 0;
+		while (column < consoleSize.i)
+		{
+			const Cell& cell = rowCells[column];
+			if (previousValid && cell == rowPrevious[column])
+			{
+				column++;
+				continue;
+			}
+
+			MoveCursor(column, row, rowCells);
+			SetColours(cell);
+			AppendGlyph(cell.glyph);
+
+			//Identical cells that follow, up to the last one that changed, are written with REP when that is shorter
+			int run = 1, repeats = 0;
+			while (column + run < consoleSize.i && rowCells[column + run] == cell)
+			{
+				if (!previousValid || !(rowCells[column + run] == rowPrevious[column + run]))
+					repeats = run;
+				run++;
+			}
+			if (repeats)
+			{
+				if (repeatSupported && 3 + (repeats > 1 ? Digits(repeats) : 0) < repeats * GlyphBytes(cell.glyph))
+				{
+					frame += "\x1b[";
+					if (repeats > 1)
+						AppendNumber(repeats);
+					frame += 'b';
+				}
+				else
+				{
+					for (int i = 0; i < repeats; i++)
+						AppendGlyph(cell.glyph);
+				}
+			}
+
+			//A cursor past the last column is waiting to wrap, only moves that set the column are safe from there
+			column += repeats + 1;
+			cursor = { column, row };
+		}
+	}
+
+	Cell* swap = previous;
+	previous = cells;
+	cells = swap;
+	previousValid = true;
+}
+
+void Terminal_Presenter::Invalidate()
+{
+	previousValid = false;
+	foreKnown = false;
+	backKnown = false;
+	cursor = { -1, -1 };
+}
+
+int Terminal_Presenter::HorizontalMove(int from, int to, int& method) const
+{
+	//Cursor back or forward, then cursor to column, then carriage return and cursor forward
+	int cost = INT_MAX;
+	bool waiting = from >= consoleSize.i;
+	if (from == to && !waiting)
+	{
+		method = Move_None;
+		return 0;
+	}
+	if (!waiting)
+	{
+		int distance = from < to ? to - from : from - to;
+		cost = 3 + (distance > 1 ? Digits(distance) : 0);
+		method = Move_Relative;
+	}
+	int column = 3 + (to > 0 ? Digits(to + 1) : 0);
+	if (column < cost)
+	{
+		cost = column;
+		method = Move_Column;
+	}
+	int carriage = 1 + (to > 0 ? 3 + (to > 1 ? Digits(to) : 0) : 0);
+	if (carriage < cost)
+	{
+		cost = carriage;
+		method = Move_Return;
+	}
+	return cost;
+}
+
+void Terminal_Presenter::MoveCursor(int column, int row, const Cell* rowCells)
+{
+	if (cursor.i == column && cursor.j == row)
+		return;
+
+	//Absolute, row 1 and column 1 can be left out
+	int best = 3 + (row > 0 ? Digits(row + 1) : 0) + (column > 0 ? 1 + Digits(column + 1) : 0);
+	int choice = Move_Absolute, horizontal = Move_None;
+
+	if (cursor.j >= 0)
+	{
+		int rows = row - cursor.j;
+		bool waiting = cursor.i >= consoleSize.i;
+
+		//Up or down keeping the column, not trusted while waiting to wrap
+		if (!waiting || rows == 0)
+		{
+			int method = Move_None;
+			int cost = (rows == 0 ? 0 : 3 + (rows > 1 || rows < -1 ? Digits(rows < 0 ? -rows : rows) : 0)) + HorizontalMove(cursor.i, column, method);
+			if (cost < best)
+			{
+				best = cost;
+				choice = Move_Relative;
+				horizontal = method;
+			}
+		}
+
+		//Carriage return then line feeds, the return makes it safe whether or not the terminal adds one to a line feed
+		if (rows > 0)
+		{
+			int method = Move_None;
+			int cost = 1 + rows + HorizontalMove(0, column, method);
+			if (cost < best)
+			{
+				best = cost;
+				choice = Move_Return;
+				horizontal = method;
+			}
+		}
+
+		//Writing the unchanged cells again is cheapest for short gaps they can be written in with the current colours
+		if (rows == 0 && !waiting && column > cursor.i)
+		{
+			int cost = 0;
+			for (int i = cursor.i; i < column && cost < best; i++)
+			{
+				const Cell& gap = rowCells[i];
+				if (!backKnown || !(gap.back == back) || (gap.glyph != L' ' && (!foreKnown || !(gap.fore == fore))))
+					cost = INT_MAX;
+				else
+					cost += GlyphBytes(gap.glyph);
+			}
+			if (cost < best)
+			{
+				best = cost;
+				choice = Move_Rewrite;
+			}
+		}
+	}
+
+	switch (choice)
+	{
+	case Move_Absolute:
+		frame += "\x1b[";
+		if (row > 0)
+			AppendNumber(row + 1);
+		if (column > 0)
+		{
+			frame += ';';
+			AppendNumber(column + 1);
+		}
+		frame += 'H';
+		break;
+	case Move_Rewrite:
+		for (int i = cursor.i; i < column; i++)
+			AppendGlyph(rowCells[i].glyph);
+		break;
+	case Move_Relative:
+		if (row != cursor.j)
+		{
+			int rows = row > cursor.j ? row - cursor.j : cursor.j - row;
+			frame += "\x1b[";
+			if (rows > 1)
+				AppendNumber(rows);
+			frame += row > cursor.j ? 'B' : 'A';
+		}
+		AppendHorizontal(cursor.i, column, horizontal);
+		break;
+	case Move_Return:
+		frame += '\r';
+		for (int i = cursor.j; i < row; i++)
+			frame += '\n';
+		AppendHorizontal(0, column, horizontal);
+		break;
+	}
+	cursor = { column, row };
+}
+
+void Terminal_Presenter::AppendHorizontal(int from, int to, int method)
+{
+	switch (method)
+	{
+	case Move_Relative:
+		frame += "\x1b[";
+		if (to - from > 1 || from - to > 1)
+			AppendNumber(to > from ? to - from : from - to);
+		frame += to > from ? 'C' : 'D';
+		break;
+	case Move_Column:
+		frame += "\x1b[";
+		if (to > 0)
+			AppendNumber(to + 1);
+		frame += 'G';
+		break;
+	case Move_Return:
+		frame += '\r';
+		if (to > 0)
+		{
+			frame += "\x1b[";
+			if (to > 1)
+				AppendNumber(to);
+			frame += 'C';
+		}
+		break;
+	}
+}
+
+void Terminal_Presenter::SetColours(const Cell& cell)
+{
+	//Spaces only show the background, so they leave the foreground as it is
+	bool setFore = cell.glyph != L' ' && (!foreKnown || !(cell.fore == fore));
+	bool setBack = !backKnown || !(cell.back == back);
+	if (!setFore && !setBack)
+		return;
+
+	//Both colours go in one sequence when both change
+	frame += "\x1b[";
+	if (setFore)
+	{
+		AppendColour(38, cell.fore, cell.foreIndex);
+		fore = cell.fore;
+		foreKnown = true;
+	}
+	if (setBack)
+	{
+		if (setFore)
+			frame += ';';
+		AppendColour(48, cell.back, cell.backIndex);
+		back = cell.back;
+		backKnown = true;
+	}
+	frame += 'm';
+}
+
+void Terminal_Presenter::AppendColour(int layer, const Colour& colour, int index)
+{
+	AppendNumber(layer);
+	if (mode != Present_Xterm256)
+	{
+		//Truecolor colours that are exactly a palette entry are shorter as its index
+		index = XtermIndex(colour);
+		if (!(xtermColours[index] == colour))
+			index = -1;
+	}
+	if (index >= 0)
+	{
+		frame += ";5;";
+		AppendNumber(index);
+		return;
+	}
+
+	frame += ";2;";
+	AppendNumber(colour.r);
+	frame += ';';
+	AppendNumber(colour.g);
+	frame += ';';
+	AppendNumber(colour.b);
+}
+
+void Terminal_Presenter::BuildXtermPalette()
+{
+	static const int levels[6] = { 0, 95, 135, 175, 215, 255 };
+	for (int i = 0; i < 16; i++)
+		xtermColours[i] = Colour(0, 0, 0);
+	for (int i = 0; i < 216; i++)
+		xtermColours[16 + i] = Colour(levels[i / 36], levels[i / 6 % 6], levels[i % 6]);
+	for (int i = 0; i < 24; i++)
+		xtermColours[232 + i] = Colour(8 + 10 * i, 8 + 10 * i, 8 + 10 * i);
+
+	//Cube levels are uneven, their midpoints are 47.5 then every 40 from 115
+	auto level = [](int value) { return value < 48 ? 0 : value < 115 ? 1 : (value - 115) / 40 + 2; };
+
+	xtermIndex = new unsigned char[32768];
+	for (int i = 0; i < 32768; i++)
+	{
+		Colour colour((i & 31) * 8 + 4, (i >> 5 & 31) * 8 + 4, (i >> 10) * 8 + 4);
+		int cube = 16 + 36 * level(colour.r) + 6 * level(colour.g) + level(colour.b);
+
+		//The grey ramp fills the gaps between the cube's greys
+		int average = (colour.r + colour.g + colour.b) / 3;
+		int grey = 232 + (average < 8 ? 0 : average > 238 ? 23 : (average - 3) / 10);
+
+		bool useGrey = Cell_Quantizer::Distance(colour, xtermColours[grey]) < Cell_Quantizer::Distance(colour, xtermColours[cube]);
+		xtermIndex[i] = (unsigned char)(useGrey ? grey : cube);
+	}
+}
+
+void Terminal_Presenter::AppendNumber(int value)
+{
+	char digits[12];
+	int length = 0;
+	do
+	{
+		digits[length++] = (char)('0' + value % 10);
+		value /= 10;
+	} while (value);
+	while (length)
+		frame += digits[--length];
+}
+
+void Terminal_Presenter::AppendGlyph(wchar_t glyph)
+{
+	//Everything the presenter writes is in the basic multilingual plane
+	if (glyph < 0x80)
+		frame += (char)glyph;
+	else if (glyph < 0x800)
+	{
+		frame += (char)(0xC0 | (glyph >> 6));
+		frame += (char)(0x80 | (glyph & 0x3F));
+	}
+	else
+	{
+		frame += (char)(0xE0 | (glyph >> 12));
+		frame += (char)(0x80 | ((glyph >> 6) & 0x3F));
+		frame += (char)(0x80 | (glyph & 0x3F));
+	}
+}
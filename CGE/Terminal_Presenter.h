@@ -0,0 +1,103 @@
+#pragma once
+#include <string>
+#include <Windows.h>
+#include "Math.h"
+#include "Colour.h"
+#include "Timer.h"
+#include "Cell_Quantizer.h"
+
+//Where frames go. The console presenter writes CHAR_INFO cells with the 16 colour palette,
+//terminal presenters write VT sequences straight from pixelBuffer and never touch the colour cube
+enum Present_Mode
+{
+	Present_Console,
+	Present_Truecolor,
+	//Colours snapped to the xterm 256 colour cube and grey ramp, for terminals without 24 bit colour
+	Present_Xterm256,
+	//No console or terminal at all, for benchmarks and checks that only need the buffers
+	Present_Headless
+};
+
+//Encodes pixelBuffer as escape sequences for VT terminals, only cells that changed since the last frame are written.
+//Every cursor move and colour change is written in whichever form takes the fewest bytes
+class Terminal_Presenter
+{
+public:
+	enum Cursor_Move
+	{
+		Move_None,
+		Move_Absolute,
+		Move_Relative,
+		Move_Column,
+		Move_Return,
+		Move_Rewrite
+	};
+
+	struct Cell
+	{
+		wchar_t glyph;
+		Colour fore;
+		Colour back;
+		//Palette entries of fore and back in xterm 256 mode, where the colours have already been snapped to them
+		unsigned char foreIndex;
+		unsigned char backIndex;
+
+		bool operator ==(const Cell& rhs) const { return glyph == rhs.glyph && fore == rhs.fore && back == rhs.back; }
+	};
+
+	HANDLE output;
+	tVector2<int> consoleSize;
+	Present_Mode mode;
+	//Cells of the frame being encoded and of the last one written, previous is invalid until the first frame
+	Cell* cells;
+	Cell* previous;
+	bool previousValid;
+	const wchar_t* quadrantGlyphs;
+	const wchar_t* brailleGlyphs;
+	std::string frame;
+
+	//xterm 256 palette and its entry for every colour with 5 bits per channel
+	Colour xtermColours[256];
+	unsigned char* xtermIndex;
+
+	//Terminal state after the last write, a column of -1 means the cursor position is unknown
+	tVector2<int> cursor;
+	//REP repeats the last glyph, xterm and Windows Terminal have it but some older terminals don't
+	bool repeatSupported;
+	Colour fore;
+	Colour back;
+	bool foreKnown;
+	bool backKnown;
+
+	Timer timer;
+	long long framesPresented;
+	long long bytesWritten;
+	double encodeTime;
+
+	//The quantizer only lends its glyph tables. A null output encodes without writing or touching the console
+	Terminal_Presenter(HANDLE output, const tVector2<int>& consoleSize, Present_Mode mode, const Cell_Quantizer& quantizer);
+	~Terminal_Presenter();
+
+	void Present(const Colour* pixels, const tVector2<int>& screenSize, Output_Mode outputMode);
+	void Resolve(const Colour* pixels, const tVector2<int>& screenSize, Output_Mode outputMode);
+	void Encode();
+	//Forgets the previous frame and the terminal state, the next frame is written in full
+	void Invalidate();
+
+	double BytesPerFrame() const { return framesPresented ? (double)bytesWritten / framesPresented : 0; }
+
+	//Entries 16 to 255 only, the first 16 follow the terminal's theme. Each of the 32768 entries is worked out directly, well under a millisecond in all
+	void BuildXtermPalette();
+	int XtermIndex(const Colour& colour) const { return xtermIndex[(colour.r >> 3) | (colour.g >> 3) << 5 | (colour.b >> 3) << 10]; }
+
+	//Bytes of the cheapest way from column from to column to on the same row, method is set to a Cursor_Move
+	int HorizontalMove(int from, int to, int& method) const;
+	void AppendHorizontal(int from, int to, int method);
+	//rowCells lets short gaps of unchanged cells be written over instead of skipped
+	void MoveCursor(int column, int row, const Cell* rowCells);
+	void SetColours(const Cell& cell);
+	//38 for the foreground or 48 for the background, then the colour as RGB or as its xterm index, -1 to look one up
+	void AppendColour(int layer, const Colour& colour, int index);
+	void AppendNumber(int value);
+	void AppendGlyph(wchar_t glyph);
+};
@@ -1 +1,51 @@
 #include "Texture.h"
+#include "Image.h"
+#include "Colour.h"
+
+Texture::Texture()
+{
+	data = nullptr;
+	textureWidth = 0;
+	textureHeight = 0;
+}
+
+Texture::~Texture()
+{
+	delete[] data;
+}
+
+bool Texture::LoadTexture(const std::string& filePath, float opacityMultiplier)
+{
+	Image image;
+	if (!image.LoadImageFile(filePath))
+		return false;
+
+	return LoadTexture(image, opacityMultiplier);
+}
+
+bool Texture::LoadTexture(const Image& image, float opacityMultiplier)
+{
+	if (!image.data)
+		return false;
+
+	delete[] data;
+	textureWidth = image.width;
+	textureHeight = image.height;
+	data = new Colour[textureWidth * textureHeight];
+
+	//Bitmaps store BGR(A) rows bottom up by default, the same way up as the screen
+	int bytesPerPixel = image.bitsPerPixel / 8;
+	int stride = (textureWidth * bytesPerPixel + 3) & ~3;
+	for (int h = 0; h < textureHeight; h++)
+	{
+		const unsigned char* row = (const unsigned char*)image.data + stride * (image.topDown ? textureHeight - h - 1 : h);
+		for (int w = 0; w < textureWidth; w++)
+		{
+			const unsigned char* pixel = row + w * bytesPerPixel;
+			int alpha = bytesPerPixel == 4 ? pixel[3] : 255;
+			data[textureWidth * h + w] = Colour(pixel[2], pixel[1], pixel[0], (int)(alpha * opacityMultiplier));
+		}
+	}
+
+	return true;
+}
@@ -1,6 +1,4 @@
 // TO DO LIST
 //Redo colour cube to store CHAR_INFO's, not w_char's.
 //Add a triangle drawing function that can use the edgebuffer.
-//Finish all straight line shape drawing.
-//Fix deltaTime representation
-//Fix ovals, there is a disconnect
\ No newline at end of file
+//Finish all straight line shape drawing.
\ No newline at end of file